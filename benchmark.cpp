@@ -0,0 +1,406 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module benchmarks the median window backends
+
+// Usage: Benchmark [largest window size]
+// Every backend is run in the steady state of a full window over window sizes from 10 up to 1M pulses
+// (or the given largest window size) and several pulse width distributions. One operation is the per-pulse
+// hot path of a channel: evicting the stale pulses, adding the new pulse and calculating the median.
+// The benchmark reports the time per operation, the time per median query alone, the heap allocations
+// per operation and the cache misses per operation.
+// Allocations are counted where the C runtime can report them (the debug CRT on Windows, glibc elsewhere)
+// and cache misses where the hardware counters are accessible (perf events on Linux);
+// the figures that cannot be measured on the platform are reported as n/a.
+
+#include <atomic>
+
+#include "functions.h"
+#include "median_window.h"
+#include "pulse_generator.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define MAX_WINDOW_SIZE 1000000         // Largest window size (pulses)
+#define LIST_MAX_WINDOW_SIZE 10000      // The list inserts in O(n), so filling larger windows takes too long
+#define OP_COUNT 200000                 // Number of measured operations per run
+#define LIST_OP_BUDGET 200000000ull     // Upper bound of list nodes visited by the measured operations
+#define PULSE_SPACING 20                // Microseconds between consecutive pulses
+
+// Pulse width distributions
+typedef enum
+{
+    DISTRIBUTION_UNIFORM,       // Uniform over the pulse width range
+    DISTRIBUTION_NORMAL,        // Normal around the middle of the range, as a steady temperature would produce
+    DISTRIBUTION_RAMP,          // Slowly rising and falling widths, as a heating and cooling cycle would produce
+    DISTRIBUTION_COUNT
+} DISTRIBUTION;
+
+static const char* distribution_name[] = { "uniform", "normal", "ramp" };
+
+// Benchmarked backends: the median window modes, the approximate trend window and the list with heap allocated nodes
+#define BACKEND_QUANTILE (MEDIAN_MODE_HISTOGRAM + 1)
+#define BACKEND_LIST_MALLOC (BACKEND_QUANTILE + 1)
+#define BACKEND_COUNT (BACKEND_LIST_MALLOC + 1)
+
+static const char* backend_name[] = { "list", "heap", "histogram", "quantile", "list-malloc" };
+
+static_assert(sizeof(backend_name) / sizeof(backend_name[0]) == BACKEND_COUNT,
+    "backend_name must have a name for every backend");
+
+// ----- Allocation counting -----
+
+static std::atomic<unsigned long long> allocation_count(0);
+static bool allocation_counting_flag = false;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+
+// Purpose: This function counts the allocations of the debug CRT heap
+static int AllocationHook(int alloc_type, void* user_data, size_t size, int block_type,
+    long request_number, const unsigned char* file_name, int line_number)
+{
+    if ((alloc_type == _HOOK_ALLOC) || (alloc_type == _HOOK_REALLOC))
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    return TRUE;
+}
+
+static void StartAllocationCounting()
+{
+    _CrtSetAllocHook(AllocationHook);
+    allocation_counting_flag = true;
+}
+
+#elif defined(__GLIBC__)
+
+// glibc lets a program replace the allocation functions and forward them to the library implementation
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size) noexcept
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) noexcept
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+static void StartAllocationCounting()
+{
+    allocation_counting_flag = true;
+}
+
+#else
+
+static void StartAllocationCounting()
+{
+}
+
+#endif
+
+// ----- Cache miss counting -----
+
+#if defined(__linux__)
+
+// Purpose: This function opens the hardware cache miss counter of the calling thread
+// Returns: The counter descriptor or -1 if the hardware counters are not accessible
+static int OpenCacheMissCounter()
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void StartCacheMissCounter(int counter)
+{
+    if (counter >= 0)
+    {
+        ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static uint64_t StopCacheMissCounter(int counter)
+{
+    uint64_t count = 0;
+
+    if (counter >= 0)
+    {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(counter, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+    }
+
+    return count;
+}
+
+#else
+
+static int OpenCacheMissCounter()
+{
+    return -1;
+}
+
+static void StartCacheMissCounter(int counter)
+{
+}
+
+static uint64_t StopCacheMissCounter(int counter)
+{
+    return 0;
+}
+
+#endif
+
+// ----- Pulse generation -----
+
+#define BENCHMARK_SEED 1        // Every run measures the same pulses
+
+// Purpose: This function generates the pulse widths of a run
+// Params: The width array, the number of widths, the distribution and the pulse width range (milliseconds)
+static void GenerateWidths(unsigned short* widths, unsigned int count, DISTRIBUTION distribution,
+    unsigned short lower, unsigned short upper)
+{
+    static const PULSE_DISTRIBUTION pulse_distribution[] =
+        { PULSE_DISTRIBUTION_UNIFORM, PULSE_DISTRIBUTION_NORMAL, PULSE_DISTRIBUTION_RAMP };
+
+    PulseGeneratorConfig config;
+    PulseGenerator generator;
+
+    // The normal distribution is centred in the range; the ramp rises and falls every 10000 pulses
+    config.distribution = pulse_distribution[distribution];
+    config.lower = lower;
+    config.upper = upper;
+    config.setpoint = (lower + upper) / 2.0;
+    config.spread = (distribution == DISTRIBUTION_NORMAL) ? (upper - lower) / 6.0 : 1.0;
+    config.step = 0.0;
+    config.period = 5000;
+
+    InitPulseGenerator(&generator, &config, BENCHMARK_SEED, distribution);
+
+    for (unsigned int i = 0; i < count; i++)
+        widths[i] = GeneratePulseWidth(&generator);
+}
+
+// ----- Benchmark runs -----
+
+// Results of a run
+typedef struct
+{
+    double op_time;                 // Nanoseconds per operation
+    double median_time;             // Nanoseconds per median query
+    double allocations;             // Heap allocations per operation
+    double cache_misses;            // Cache misses per operation, negative if not measured
+} BenchmarkResult;
+
+// Window under benchmark
+typedef struct
+{
+    unsigned int backend;
+    MedianWindow window;            // Median window modes
+    QuantileWindow quantile_window; // Approximate trend window
+    struct Node* head_ptr;          // List with heap allocated nodes
+    MedianTracker median_tracker;
+    uint64_t window_length;         // Microseconds
+} BenchmarkWindow;
+
+// Purpose: This function performs one operation: evicts the stale pulses, adds the pulse and calculates the median
+static inline unsigned int ProcessBenchmarkPulse(BenchmarkWindow* bench, Pulse pulse)
+{
+    if (bench->backend == BACKEND_LIST_MALLOC)
+    {
+        bench->head_ptr = DeleteStalePulses(bench->head_ptr, pulse.timestamp, bench->window_length,
+            NULL, &bench->median_tracker, NULL);
+        InsertPulse(&bench->head_ptr, MakeNode(NULL, pulse), &bench->median_tracker);
+
+        return FindMedian(&bench->median_tracker);
+    }
+
+    if (bench->backend == BACKEND_QUANTILE)
+    {
+        EvictStaleQuantilePulses(&bench->quantile_window, pulse.timestamp);
+        AddQuantilePulse(&bench->quantile_window, pulse);
+
+        return GetQuantile(&bench->quantile_window, QUANTILE_P50);
+    }
+
+    EvictStaleWindowPulses(&bench->window, pulse.timestamp, NULL);
+    AddWindowPulse(&bench->window, pulse, NULL);
+
+    return GetWindowMedian(&bench->window);
+}
+
+// Purpose: This function calculates the median of the window
+static inline unsigned int GetBenchmarkMedian(const BenchmarkWindow* bench)
+{
+    if (bench->backend == BACKEND_LIST_MALLOC)
+        return FindMedian(&bench->median_tracker);
+
+    if (bench->backend == BACKEND_QUANTILE)
+        return GetQuantile(&bench->quantile_window, QUANTILE_P50);
+
+    return GetWindowMedian(&bench->window);
+}
+
+// Purpose: This function runs a backend over a window of the given size
+// Params: The backend, window size, pulse widths (window size plus the number of operations),
+// number of operations, pulse width range (milliseconds), cache miss counter and a pointer to the results
+// Returns: True if the window storage has been allocated; false otherwise
+static bool RunBenchmark(unsigned int backend, unsigned int size, const unsigned short* widths,
+    unsigned int op_count, unsigned short lower, unsigned short upper, int cache_counter, BenchmarkResult* result)
+{
+    BenchmarkWindow bench;
+
+    bench.backend = backend;
+    bench.head_ptr = NULL;
+    bench.window_length = (uint64_t)(size - 1) * PULSE_SPACING;
+    InitMedianTracker(&bench.median_tracker);
+
+    if (backend == BACKEND_QUANTILE)
+        InitQuantileWindow(&bench.quantile_window, bench.window_length);
+    else if ((backend != BACKEND_LIST_MALLOC) &&
+        !InitMedianWindow(&bench.window, (MEDIAN_MODE)backend, lower, upper, size + 1, bench.window_length))
+        return false;
+
+    // Fill the window, so that every measured operation evicts one pulse and adds another
+    uint64_t timestamp = PULSE_SPACING;
+
+    for (unsigned int i = 0; i < size; i++, timestamp += PULSE_SPACING)
+        ProcessBenchmarkPulse(&bench, { true, widths[i], timestamp });
+
+    volatile unsigned int median_sink = 0;
+
+    unsigned long long start_allocation_count = allocation_count.load();
+    StartCacheMissCounter(cache_counter);
+    uint64_t start_time = GetMonotonicTimeNs();
+
+    for (unsigned int i = 0; i < op_count; i++, timestamp += PULSE_SPACING)
+        median_sink = ProcessBenchmarkPulse(&bench, { true, widths[size + i], timestamp });
+
+    uint64_t op_time = GetMonotonicTimeNs() - start_time;
+    uint64_t cache_miss_count = StopCacheMissCounter(cache_counter);
+    unsigned long long op_allocation_count = allocation_count.load() - start_allocation_count;
+
+    start_time = GetMonotonicTimeNs();
+
+    for (unsigned int i = 0; i < op_count; i++)
+        median_sink = GetBenchmarkMedian(&bench);
+
+    uint64_t median_time = GetMonotonicTimeNs() - start_time;
+
+    (void)median_sink;
+
+    result->op_time = (double)op_time / op_count;
+    result->median_time = (double)median_time / op_count;
+    result->allocations = (double)op_allocation_count / op_count;
+    result->cache_misses = (cache_counter >= 0) ? ((double)cache_miss_count / op_count) : -1.0;
+
+    if (backend == BACKEND_LIST_MALLOC)
+        DeleteStalePulses(bench.head_ptr, UINT64_MAX, 0, NULL, NULL, NULL);
+    else if (backend != BACKEND_QUANTILE)
+        FreeMedianWindow(&bench.window);
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int max_size = (argc > 1) ? (unsigned int)strtoul(argv[1], NULL, 10) : MAX_WINDOW_SIZE;
+
+    if (max_size < 10)
+    {
+        fprintf(stderr, "Usage: %s [largest window size, at least 10]\n", argv[0]);
+        return 1;
+    }
+
+    // The backends must not spend the measured time on logging
+    SetLogLevel(LOG_LEVEL_NONE);
+    StartAllocationCounting();
+
+    int cache_counter = OpenCacheMissCounter();
+    unsigned short* widths = (unsigned short*)malloc(sizeof(unsigned short) * ((size_t)max_size + OP_COUNT));
+
+    if (widths == NULL)
+        return 1;
+
+    printf("%-12s %-9s %8s %12s %12s %12s %12s\n",
+        "backend", "widths", "size", "ns/op", "median ns", "allocs/op", "misses/op");
+
+    for (unsigned int size = 10; size <= max_size; size *= 10)
+    {
+        for (unsigned int distribution = 0; distribution < DISTRIBUTION_COUNT; distribution++)
+        {
+            GenerateWidths(widths, size + OP_COUNT, (DISTRIBUTION)distribution,
+                pulse_width_lower_limit, pulse_width_upper_limit);
+
+            for (unsigned int backend = 0; backend < BACKEND_COUNT; backend++)
+            {
+                bool list_flag = (backend == MEDIAN_MODE_LIST) || (backend == BACKEND_LIST_MALLOC);
+
+                if (list_flag && (size > LIST_MAX_WINDOW_SIZE))
+                    continue;
+
+                // An operation on the list visits about half of its nodes
+                unsigned int op_count = OP_COUNT;
+
+                if (list_flag && ((unsigned long long)op_count * size / 2 > LIST_OP_BUDGET))
+                    op_count = (unsigned int)(LIST_OP_BUDGET * 2 / size);
+
+                BenchmarkResult result;
+
+                if (!RunBenchmark(backend, size, widths, op_count, pulse_width_lower_limit,
+                    pulse_width_upper_limit, cache_counter, &result))
+                {
+                    fprintf(stderr, "Cannot allocate a %s window of %u pulses\n", backend_name[backend], size);
+                    continue;
+                }
+
+                printf("%-12s %-9s %8u %12.1f %12.1f ", backend_name[backend], distribution_name[distribution],
+                    size, result.op_time, result.median_time);
+
+                if (allocation_counting_flag)
+                    printf("%12.3f ", result.allocations);
+                else
+                    printf("%12s ", "n/a");
+
+                if (result.cache_misses >= 0.0)
+                    printf("%12.2f\n", result.cache_misses);
+                else
+                    printf("%12s\n", "n/a");
+            }
+        }
+    }
+
+    free(widths);
+
+    return 0;
+}
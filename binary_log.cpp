@@ -0,0 +1,100 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements compact binary log format
+
+#include "binary_log.h"
+#include "logger.h"
+#include "rolling_log.h"
+
+// Purpose: This utility function maps a record type to its log level
+static int GetRecordLogLevel(RECORD_TYPE type)
+{
+    switch (type)
+    {
+    case RECORD_NEW_PULSE:
+        return LOG_LEVEL_PULSE;
+    case RECORD_STALE_PULSE:
+        return LOG_LEVEL_TRACE;
+    case RECORD_MEDIAN:
+    case RECORD_BATCH_PULSE:
+        return LOG_LEVEL_MEDIAN;
+    default:
+        return LOG_LEVEL_ALERT;
+    }
+}
+
+// Purpose: This function checks whether binary records are being logged
+bool IsBinaryLogSink()
+{
+    return (GetLogSink() == LOG_SINK_BINARY);
+}
+
+// Purpose: This function fills in the binary log file header, which records the runtime log level
+void InitBinaryLogHeader(BinaryLogHeader* header)
+{
+    memset(header, 0, sizeof(BinaryLogHeader));
+    memcpy(header->magic, BINARY_LOG_MAGIC, sizeof(header->magic));
+    header->version = BINARY_LOG_VERSION;
+    header->record_size = sizeof(BinaryLogRecord);
+    header->log_level = (uint16_t)GetLogLevel();
+}
+
+// Purpose: This function writes the binary log file header
+// Returns: True if the header has been written; false otherwise
+bool WriteBinaryLogHeader(FILE* fptr)
+{
+    BinaryLogHeader header;
+
+    InitBinaryLogHeader(&header);
+
+    return WriteLogFile(&header, sizeof(header), fptr);
+}
+
+// Purpose: This function reads and validates the binary log file header
+// Returns: True if the file is a binary log file of a supported version; false otherwise
+bool ReadBinaryLogHeader(FILE* fptr, BinaryLogHeader* header)
+{
+    if (fread(header, sizeof(BinaryLogHeader), 1, fptr) != 1)
+        return false;
+
+    return ((memcmp(header->magic, BINARY_LOG_MAGIC, sizeof(header->magic)) == 0) && 
+        (header->version == BINARY_LOG_VERSION) && (header->record_size == sizeof(BinaryLogRecord)));
+}
+
+// Purpose: This function logs a binary record of the channel of the calling thread if the binary log sink 
+// is selected and the record log level is enabled
+// If the logger is running, the record is handed over to the logging thread; otherwise it is written directly
+// Params: Record type, pulse width (milliseconds), record type specific value, timestamp (microseconds) 
+// and the log file pointer
+void LogBinaryRecord(RECORD_TYPE type, unsigned short width, uint32_t value, uint64_t timestamp, FILE* fptr)
+{
+    if ((fptr == NULL) || (!IsBinaryLogSink()) || (!LOG_ENABLED(GetRecordLogLevel(type))))
+        return;
+
+    BinaryLogRecord record;
+
+    record.timestamp = timestamp;
+    record.value = value;
+    record.width = width;
+    record.type = (uint8_t)type;
+    record.reserved = 0;
+    record.channel = (uint16_t)((GetLogChannel() != LOG_CHANNEL_NONE) ? GetLogChannel() : 0);
+    memset(record.padding, 0, sizeof(record.padding));
+
+    if (IsLoggerRunning())
+        LogWriteRecord(&record, sizeof(record));
+    else
+        WriteLogFile(&record, sizeof(record), fptr);
+}
+
+// Purpose: This function reads the next binary record
+// A record of an unknown type ends the log: it is the unwritten, zero-filled tail of a segment that was not closed cleanly
+// Returns: True if a record has been read; false at the end of the file or of the written records
+bool ReadBinaryLogRecord(FILE* fptr, BinaryLogRecord* record)
+{
+    if (fread(record, sizeof(BinaryLogRecord), 1, fptr) != 1)
+        return false;
+
+    return ((record->type >= RECORD_NEW_PULSE) && (record->type < RECORD_TYPE_END));
+}
@@ -0,0 +1,66 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines compact binary log format
+
+#pragma once
+
+#include "functions.h"
+
+#define BINARY_LOG_MAGIC    "ETBL"
+#define BINARY_LOG_VERSION  5
+
+// The binary log is an alternative log sink that replaces the formatted text records with 
+// fixed-size binary records. A log file starts with a header followed by the records in the 
+// order they have been written. The sorted window dump ("List:") is not recorded at all, 
+// since it can be rebuilt from the new pulse and stale pulse records. The log converter 
+// renders a binary log file in the human-readable text layout.
+// Every record carries the identifier of its channel, so the records of all channels share one log.
+// Record types start at 1, so the zero-filled tail of a preallocated log segment that was not closed cleanly 
+// never reads as records; reading stops at the first record of an unknown type.
+
+// Binary log record types
+typedef enum {
+    RECORD_NEW_PULSE = 1,   // width: pulse width, timestamp: pulse arrival time
+    RECORD_STALE_PULSE,     // width: evicted pulse width, timestamp: evicted pulse arrival time
+    RECORD_ALERT,           // value: alert duration (milliseconds), precedes the median record it belongs to
+    RECORD_MEDIAN,          // width: processed pulse width, value: median pulse width times two
+    RECORD_WARNING_ON,      // timestamp: transition time
+    RECORD_WARNING_OFF,     // timestamp: transition time
+    RECORD_BATCH_PULSE,     // width: pulse width added ahead of the median record of its batch, timestamp: pulse arrival time
+    RECORD_IDLE,            // timestamp: transition time
+    RECORD_PRE_ALARM,       // timestamp: transition time
+    RECORD_LATCHED,         // timestamp: transition time
+    RECORD_ACKNOWLEDGED,    // timestamp: transition time
+    RECORD_TYPE_END         // One past the last record type
+} RECORD_TYPE;
+
+// Binary log file header
+typedef struct
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint16_t log_level;     // Runtime log level of the writer
+    uint16_t reserved[3];
+} BinaryLogHeader;
+
+// Binary log record
+typedef struct
+{
+    uint64_t timestamp;     // Monotonic time (microseconds)
+    uint32_t value;         // Record type specific value
+    uint16_t width;         // Milliseconds
+    uint8_t type;           // RECORD_TYPE
+    uint8_t reserved;
+    uint16_t channel;       // Channel identifier
+    uint8_t padding[6];     // Zero, keeps the record size a multiple of the timestamp alignment
+} BinaryLogRecord;
+
+// Function declarations
+bool IsBinaryLogSink();
+void InitBinaryLogHeader(BinaryLogHeader* header);
+bool WriteBinaryLogHeader(FILE* fptr);
+bool ReadBinaryLogHeader(FILE* fptr, BinaryLogHeader* header);
+void LogBinaryRecord(RECORD_TYPE type, unsigned short width, uint32_t value, uint64_t timestamp, FILE* fptr);
+bool ReadBinaryLogRecord(FILE* fptr, BinaryLogRecord* record);
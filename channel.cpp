@@ -0,0 +1,467 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements thermostat channel
+
+#include "channel.h"
+#include "binary_log.h"
+#include "pulse_kernels.h"
+
+// Purpose: This function initializes channel
+// Params: A pointer to the channel, channel identifier and channel configuration, which must outlive the channel
+// Returns: True if the channel storage has been allocated; false otherwise
+bool InitChannel(Channel* channel, unsigned int id, const ChannelConfig* config)
+{
+    channel->id = id;
+    channel->config = config;
+    channel->threshold_sequence = ReadAlertThresholds(config->threshold_state, &channel->thresholds);
+#ifdef VERIFY_MEDIAN
+    channel->head_ptr = NULL;
+    InitMedianTracker(&channel->median_tracker);
+#endif
+    channel->pulse_width_median = 0;
+    channel->warning_alert_flag = false;
+    channel->warning_alert_timestamp = GetMonotonicTime();
+    channel->alert_state.sequence.store(0);
+    channel->alert_state.change_count.store(0);
+    channel->alert_state.onset_timestamp.store(channel->warning_alert_timestamp);
+
+    for (unsigned int i = 0; i < ALERT_CHANGE_HISTORY; i++)
+    {
+        channel->alert_state.changes[i].raised_flag.store(false);
+        channel->alert_state.changes[i].held_flag.store(false);
+        channel->alert_state.changes[i].publish_timestamp.store(channel->warning_alert_timestamp);
+    }
+
+    channel->published_raised_flag = false;
+    channel->published_held_flag = false;
+    channel->observed_change_count = 0;
+    channel->acknowledge_flag.store(false);
+    channel->raised_input_flag = false;
+    channel->held_input_flag = false;
+    channel->processed_count = 0;
+    channel->above_threshold_count = 0;
+    channel->wakeup_latency_total = 0;
+    channel->wakeup_latency_max = 0;
+    channel->alert_latency_total = 0;
+    channel->alert_latency_max = 0;
+    channel->alert_change_count = 0;
+    channel->lost_change_count = 0;
+
+    Init(&channel->state_machine);
+    InitChannelStats(&channel->stats);
+
+    if (!InitMedianWindow(&channel->window, config->median_mode, config->pulse_width_lower_limit, 
+        config->pulse_width_upper_limit, config->window_capacity, config->window_length))
+    {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < config->trend_window_count; i++)
+    {
+        if (!AddTrendWindow(&channel->window, config->trend_window_lengths[i], config->trend_window_backends[i]))
+        {
+            FreeMedianWindow(&channel->window);
+            return false;
+        }
+    }
+
+    if (!InitPulseQueue(&channel->queue, config->pulse_queue_capacity))
+    {
+        FreeMedianWindow(&channel->window);
+        return false;
+    }
+
+    return true;
+}
+
+// Purpose: This function releases channel storage
+void FreeChannel(Channel* channel)
+{
+    FreeMedianWindow(&channel->window);
+    FreePulseQueue(&channel->queue);
+}
+
+// Purpose: This function publishes a change of the alert state of the channel
+// Only the worker processing the channel may publish, so there is never more than one writer
+// Params: A pointer to the channel, the alert flags, the start of the alert and the current time
+static void PublishChannelAlertState(Channel* channel, bool raised_flag, bool held_flag, 
+    uint64_t onset_timestamp, uint64_t current_time)
+{
+    AlertState* state = &channel->alert_state;
+    unsigned int sequence = state->sequence.load(std::memory_order_relaxed);
+    unsigned int change_count = state->change_count.load(std::memory_order_relaxed);
+    AlertChange* change = &state->changes[change_count % ALERT_CHANGE_HISTORY];
+
+    state->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    change->raised_flag.store(raised_flag, std::memory_order_relaxed);
+    change->held_flag.store(held_flag, std::memory_order_relaxed);
+    change->publish_timestamp.store(current_time, std::memory_order_relaxed);
+    state->onset_timestamp.store(onset_timestamp, std::memory_order_relaxed);
+    state->change_count.store(change_count + 1, std::memory_order_relaxed);
+
+    state->sequence.store(sequence + 2, std::memory_order_release);
+
+    channel->published_raised_flag = raised_flag;
+    channel->published_held_flag = held_flag;
+}
+
+// Purpose: This function reads a consistent copy of the alert state of the channel without locking
+// Params: A pointer to the channel and a pointer to the copy
+void ReadChannelAlertState(Channel* channel, AlertSnapshot* snapshot)
+{
+    AlertState* state = &channel->alert_state;
+    unsigned int sequence;
+
+    do
+    {
+        sequence = state->sequence.load(std::memory_order_acquire);
+
+        snapshot->change_count = state->change_count.load(std::memory_order_relaxed);
+        snapshot->onset_timestamp = state->onset_timestamp.load(std::memory_order_relaxed);
+
+        for (unsigned int i = 0; i < ALERT_CHANGE_HISTORY; i++)
+        {
+            snapshot->changes[i].raised_flag = state->changes[i].raised_flag.load(std::memory_order_relaxed);
+            snapshot->changes[i].held_flag = state->changes[i].held_flag.load(std::memory_order_relaxed);
+            snapshot->changes[i].publish_timestamp = state->changes[i].publish_timestamp.load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+    } while (((sequence & 1) != 0) || (sequence != state->sequence.load(std::memory_order_relaxed)));
+
+    // The latest flags are those of the latest change, or the initial clear flags before the first change
+    const AlertChangeSnapshot* latest = &snapshot->changes[(snapshot->change_count + ALERT_CHANGE_HISTORY - 1) % ALERT_CHANGE_HISTORY];
+
+    snapshot->raised_flag = (snapshot->change_count > 0) ? latest->raised_flag : false;
+    snapshot->held_flag = (snapshot->change_count > 0) ? latest->held_flag : false;
+}
+
+// Purpose: This function initializes the shared alert thresholds
+// Params: A pointer to the threshold state and the initial thresholds
+void InitThresholdState(ThresholdState* state, const AlertThresholds* thresholds)
+{
+    state->sequence.store(0, std::memory_order_relaxed);
+    state->pulse_width_warning_threshold.store(thresholds->pulse_width_warning_threshold, std::memory_order_relaxed);
+    state->median_warning_threshold.store(thresholds->median_warning_threshold, std::memory_order_relaxed);
+    state->warning_threshold.store(thresholds->warning_threshold, std::memory_order_release);
+}
+
+// Purpose: This function publishes new alert thresholds to every channel
+// It must be called by one thread at a time; the workers pick up the thresholds before their next drain of the queue
+// Params: A pointer to the threshold state and the new thresholds
+void PublishAlertThresholds(ThresholdState* state, const AlertThresholds* thresholds)
+{
+    unsigned int sequence = state->sequence.load(std::memory_order_relaxed);
+
+    state->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    state->pulse_width_warning_threshold.store(thresholds->pulse_width_warning_threshold, std::memory_order_relaxed);
+    state->median_warning_threshold.store(thresholds->median_warning_threshold, std::memory_order_relaxed);
+    state->warning_threshold.store(thresholds->warning_threshold, std::memory_order_relaxed);
+
+    state->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Purpose: This function reads a consistent copy of the alert thresholds without locking
+// Params: A pointer to the threshold state and a pointer to the copy
+// Returns: The sequence the copy was read at, which changes whenever new thresholds are published
+unsigned int ReadAlertThresholds(ThresholdState* state, AlertThresholds* thresholds)
+{
+    unsigned int sequence;
+
+    do
+    {
+        sequence = state->sequence.load(std::memory_order_acquire);
+
+        thresholds->pulse_width_warning_threshold = state->pulse_width_warning_threshold.load(std::memory_order_relaxed);
+        thresholds->median_warning_threshold = state->median_warning_threshold.load(std::memory_order_relaxed);
+        thresholds->warning_threshold = state->warning_threshold.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+    } while (((sequence & 1) != 0) || (sequence != state->sequence.load(std::memory_order_relaxed)));
+
+    return sequence;
+}
+
+// Purpose: This function processes a new pulse of the channel
+// It evicts stale pulses, adds the new pulse to the window, calculates the median and 
+// commands the warnings when the median has exceeded the warning threshold for longer than allowed
+// Params: A pointer to the channel, a pulse with the youngest timestamp and the log file pointer
+void ProcessChannelPulse(Channel* channel, Pulse pulse, FILE* fptr)
+{
+    ProcessChannelPulseBatch(channel, &pulse, 1, fptr);
+}
+
+// Purpose: This function processes a batch of pulses of the channel with a single median update
+// Stale pulses are evicted once against the youngest pulse of the batch, then the whole batch is added to the window 
+// and the median and the alert decision are made once, so their cost is shared by all pulses of the batch
+// Params: A pointer to the channel, time-ordered pulses, the number of pulses and the log file pointer
+void ProcessChannelPulseBatch(Channel* channel, const Pulse* pulses, unsigned int count, FILE* fptr)
+{
+    if (count == 0)
+        return;
+
+    const Pulse pulse = pulses[count - 1];     // Youngest pulse of the batch
+    const int log_channel = GetLogChannel();
+
+    SetLogChannel((int)channel->id);
+
+    STATS_TIMESTAMP(start_time);
+
+    uint64_t processing_time = GetMonotonicTime();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        uint64_t latency = processing_time - pulses[i].timestamp;
+
+        channel->wakeup_latency_total += latency;
+
+        if (latency > channel->wakeup_latency_max)
+            channel->wakeup_latency_max = latency;
+
+#ifdef STATS_MODE
+        // The wakeup latency is in microseconds, stage latencies in nanoseconds
+        RecordStageLatency(&channel->stats, STATS_STAGE_INGEST, latency * 1000);
+#endif
+    }
+
+    channel->processed_count += count;
+
+    STATS_TIMESTAMP(ingest_time);
+
+    unsigned int evicted_count = EvictStaleWindowPulses(&channel->window, pulse.timestamp, fptr);
+
+    STATS_TIMESTAMP(evict_time);
+
+    evicted_count += AddWindowPulses(&channel->window, pulses, count, fptr);
+
+    STATS_TIMESTAMP(insert_time);
+
+    PrintMedianWindow(&channel->window, fptr);
+
+    STATS_TIMESTAMP(median_start_time);
+
+    channel->pulse_width_median = GetWindowMedian(&channel->window);
+
+    STATS_TIMESTAMP(median_time);
+
+#ifdef VERIFY_MEDIAN
+    for (unsigned int i = 0; i < count; i++)
+    {
+        channel->head_ptr = DeleteStalePulses(channel->head_ptr, pulses[i].timestamp, channel->config->window_length, NULL, &channel->median_tracker, NULL);
+        InsertPulse(&channel->head_ptr, MakeNode(NULL, pulses[i]), &channel->median_tracker);
+    }
+
+    channel->head_ptr = DeleteStalePulses(channel->head_ptr, pulse.timestamp, channel->config->window_length, NULL, &channel->median_tracker, NULL);
+
+    if (FindMedian(&channel->median_tracker) != channel->pulse_width_median)
+    {
+        PrintStr("Median mismatch:", fptr);
+        PrintTemp(ConvertDoubledPulseWidthToTemp(FindMedian(&channel->median_tracker)), fptr);
+        PrintStr("\n", fptr);
+    }
+#endif
+
+    bool median_logged = LOG_ENABLED(LOG_LEVEL_MEDIAN);
+
+    if (median_logged)
+    {
+        PrintStr("Median:", fptr);
+        PrintTemp(ConvertDoubledPulseWidthToTemp(channel->pulse_width_median), fptr);
+    }
+
+    STATS_TIMESTAMP(alert_start_time);
+
+    uint64_t current_time = GetMonotonicTime();
+
+    // Check to see whether the temperature median has exceeded the temperature warning threshold
+    // The median is doubled, so the integer comparison against the compile-time threshold is exact
+    if (channel->pulse_width_median > channel->thresholds.median_warning_threshold)
+    {
+        channel->warning_alert_flag = true;
+
+        if (LOG_ENABLED(LOG_LEVEL_ALERT))
+        {
+            PrintStr(median_logged ? " - Alert duration" : "Alert duration", fptr);
+            PrintInt((int)((current_time - channel->warning_alert_timestamp) / ONE_MSEC_IN_USEC), fptr);
+            PrintStr("\n", fptr);
+        }
+        else if (median_logged)
+        {
+            PrintStr("\n", fptr);
+        }
+
+        LogBinaryRecord(RECORD_ALERT, 0, 
+            (uint32_t)((current_time - channel->warning_alert_timestamp) / ONE_MSEC_IN_USEC), current_time, fptr);
+    }
+    else
+    {
+        channel->warning_alert_flag = false;
+        channel->warning_alert_timestamp = current_time;
+
+        if (median_logged)
+            PrintStr("\n", fptr);
+    }
+
+    LogBinaryRecord(RECORD_MEDIAN, pulse.width, channel->pulse_width_median, pulse.timestamp, fptr);
+
+    bool held_flag = ((channel->warning_alert_flag == true) 
+        && (IsTimeout(current_time, channel->warning_alert_timestamp, channel->thresholds.warning_threshold))) ? true : false;
+
+    // The alert state is published only when it changes, so the publication time is the time of the change
+    if ((channel->warning_alert_flag != channel->published_raised_flag) || (held_flag != channel->published_held_flag))
+    {
+        PublishChannelAlertState(channel, channel->warning_alert_flag, held_flag, 
+            channel->warning_alert_timestamp, current_time);
+    }
+
+    STATS_TIMESTAMP(alert_time);
+
+    STATS_RECORD_STAGE(&channel->stats, STATS_STAGE_EVICT, ingest_time, evict_time);
+    STATS_RECORD_STAGE(&channel->stats, STATS_STAGE_INSERT, evict_time, insert_time);
+    STATS_RECORD_STAGE(&channel->stats, STATS_STAGE_MEDIAN, median_start_time, median_time);
+    STATS_RECORD_STAGE(&channel->stats, STATS_STAGE_ALERT, alert_start_time, alert_time);
+#ifdef STATS_MODE
+    // The total spans from the arrival of the oldest pulse of the batch: its wait for processing, 
+    // measured by the monotonic time in microseconds, plus the processing stages in nanoseconds
+    uint64_t queue_latency_ns = (processing_time - pulses[0].timestamp) * 1000;
+    uint64_t total_latency_ns = (alert_time - start_time) + queue_latency_ns;
+
+    RecordStageLatency(&channel->stats, STATS_STAGE_TOTAL, total_latency_ns);
+#endif
+    STATS_COUNT(&channel->stats, STATS_COUNTER_PROCESSED, count);
+    STATS_COUNT(&channel->stats, STATS_COUNTER_EVICTED, evicted_count);
+    STATS_WINDOW_SIZE(&channel->stats, GetWindowPulseCount(&channel->window));
+
+    SetLogChannel(log_channel);
+}
+
+// Purpose: This function processes every pulse that has been queued for the channel
+// The queue is drained in batches, whose pulse widths are checked against the warning threshold in one pass.
+// With batch ingest each drained batch updates the median once; otherwise the median is updated for every pulse.
+// Returns: The number of processed pulses
+unsigned int ProcessChannelPulses(Channel* channel, FILE* fptr)
+{
+    unsigned int count = 0;
+    unsigned int batch_count = 0;
+    Pulse pulses[PULSE_BATCH_SIZE];
+    unsigned short widths[PULSE_BATCH_SIZE];
+
+    // Pick up new thresholds, if any have been published
+    if (channel->config->threshold_state->sequence.load(std::memory_order_acquire) != channel->threshold_sequence)
+        channel->threshold_sequence = ReadAlertThresholds(channel->config->threshold_state, &channel->thresholds);
+
+    do
+    {
+        batch_count = 0;
+
+        while ((batch_count < PULSE_BATCH_SIZE) && DequeuePulse(&channel->queue, &pulses[batch_count]))
+        {
+            widths[batch_count] = pulses[batch_count].width;
+            batch_count++;
+        }
+
+        channel->above_threshold_count += 
+            ConvertPulseWidths(widths, NULL, NULL, batch_count, channel->thresholds.pulse_width_warning_threshold);
+
+        if (channel->config->batch_ingest_flag)
+        {
+            ProcessChannelPulseBatch(channel, pulses, batch_count, fptr);
+        }
+        else
+        {
+            for (unsigned int i = 0; i < batch_count; i++)
+                ProcessChannelPulse(channel, pulses[i], fptr);
+        }
+
+        count += batch_count;
+
+    } while (batch_count == PULSE_BATCH_SIZE);
+
+    return count;
+}
+
+// Purpose: This function advances the state machine of the channel by one step
+// Each change of the alert inputs since the previous step is fed to the state machine as an event, in the order 
+// the changes were published; when nothing has changed the step is a tick, which toggles the warnings of an alarm on and off.
+// The alert state is read without locking, so the worker processing the channel is never held up by the warnings.
+void TickChannelWarnings(Channel* channel, FILE* fptr)
+{
+    AlertSnapshot snapshot;
+    ReadChannelAlertState(channel, &snapshot);
+
+    const int log_channel = GetLogChannel();
+    uint64_t current_time = GetMonotonicTime();
+    unsigned int first_count = channel->observed_change_count;
+    bool event_flag = false;
+
+    SetLogChannel((int)channel->id);
+
+    // Changes older than the history have been overwritten, only their number is known
+    if ((snapshot.change_count - first_count) > ALERT_CHANGE_HISTORY)
+    {
+        channel->lost_change_count += snapshot.change_count - first_count - ALERT_CHANGE_HISTORY;
+        first_count = snapshot.change_count - ALERT_CHANGE_HISTORY;
+    }
+
+    for (unsigned int count = first_count; count != snapshot.change_count; count++)
+    {
+        const AlertChangeSnapshot* change = &snapshot.changes[count % ALERT_CHANGE_HISTORY];
+
+        // Measure how long the change took to reach the warning thread
+        uint64_t alert_latency = current_time - change->publish_timestamp;
+
+        channel->alert_latency_total += alert_latency;
+        channel->alert_change_count++;
+
+        if (alert_latency > channel->alert_latency_max)
+            channel->alert_latency_max = alert_latency;
+
+        if ((change->raised_flag == true) && (channel->raised_input_flag == false))
+        {
+            Transition(&channel->state_machine, EVENT_ALERT_RAISED, fptr);
+            event_flag = true;
+        }
+
+        if ((change->held_flag == true) && (channel->held_input_flag == false))
+        {
+            Transition(&channel->state_machine, EVENT_ALERT_HELD, fptr);
+            event_flag = true;
+        }
+
+        if ((change->raised_flag == false) && (channel->raised_input_flag == true))
+        {
+            Transition(&channel->state_machine, EVENT_ALERT_CLEARED, fptr);
+            event_flag = true;
+        }
+
+        channel->raised_input_flag = change->raised_flag;
+        channel->held_input_flag = change->held_flag;
+    }
+
+    channel->observed_change_count = snapshot.change_count;
+
+    if (channel->acknowledge_flag.exchange(false) == true)
+    {
+        Transition(&channel->state_machine, EVENT_ACKNOWLEDGE, fptr);
+        event_flag = true;
+    }
+
+    if (event_flag == false)
+        Transition(&channel->state_machine, EVENT_TICK, fptr);
+
+    SetLogChannel(log_channel);
+}
+
+// Purpose: This function requests the acknowledgement of the alarm of the channel
+// The request is fed to the state machine by the next step of the warnings
+void AcknowledgeChannelWarnings(Channel* channel)
+{
+    channel->acknowledge_flag.store(true);
+}
@@ -0,0 +1,143 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines thermostat channel
+
+#pragma once
+
+#include <atomic>
+
+#include "functions.h"
+#include "state_machine.h"
+#include "median_window.h"
+#include "pulse_queue.h"
+#include "stats.h"
+
+// A channel bundles everything needed to process the pulses of one temperature sensor: 
+// the queue that delivers its pulses, the median window, the alert state and the state machine 
+// that governs its warnings. Channels share no state, so different channels can be processed 
+// by different threads; a single channel is processed by one thread at a time.
+
+#define PULSE_BATCH_SIZE 64         // Maximum number of pulses drained from the queue at once
+#define ALERT_CHANGE_HISTORY 8      // Number of the most recent alert changes kept for the warning thread
+
+// Change of the alert flags
+typedef struct
+{
+    std::atomic<bool> raised_flag;              // The median exceeds the warning threshold
+    std::atomic<bool> held_flag;                // The median has exceeded the warning threshold for longer than allowed
+    std::atomic<uint64_t> publish_timestamp;    // Time of the change (microseconds)
+} AlertChange;
+
+// Alert state of a channel, published by the worker processing the channel and read by the warning thread without locking.
+// The state is a sequence lock: the single writer makes the sequence odd while it updates the fields and even again 
+// once it is done, and a reader retries whenever the sequence was odd or has changed while it copied the fields.
+// Every change is numbered and kept in a short history, so the warning thread sees an alert that is raised and 
+// cleared again between two of its steps instead of only the latest flags.
+typedef struct
+{
+    std::atomic<unsigned int> sequence;
+    std::atomic<unsigned int> change_count;     // Number of published changes, change n is kept at n % ALERT_CHANGE_HISTORY
+    std::atomic<uint64_t> onset_timestamp;      // Start of the alert (microseconds)
+    AlertChange changes[ALERT_CHANGE_HISTORY];  // Most recent changes
+} AlertState;
+
+// Copy of a change of the alert flags
+typedef struct
+{
+    bool raised_flag;
+    bool held_flag;
+    uint64_t publish_timestamp;
+} AlertChangeSnapshot;
+
+// Consistent copy of the alert state
+typedef struct
+{
+    bool raised_flag;                   // Latest flags
+    bool held_flag;
+    uint64_t onset_timestamp;
+    unsigned int change_count;
+    AlertChangeSnapshot changes[ALERT_CHANGE_HISTORY];
+} AlertSnapshot;
+
+// Thresholds of the alert decision, which can be changed while the channels are being processed
+typedef struct
+{
+    unsigned short pulse_width_warning_threshold;   // Largest pulse width not exceeding the temperature limit (milliseconds)
+    unsigned int median_warning_threshold;          // Largest doubled median not exceeding the temperature limit
+    uint64_t warning_threshold;                     // Longest alert before the alarm (microseconds)
+} AlertThresholds;
+
+// Alert thresholds shared by all channels, published by a single writer and read by the workers without locking.
+// Like the alert state, the thresholds are a sequence lock, so a worker never sees a mix of old and new thresholds.
+typedef struct
+{
+    std::atomic<unsigned int> sequence;
+    std::atomic<unsigned short> pulse_width_warning_threshold;
+    std::atomic<unsigned int> median_warning_threshold;
+    std::atomic<uint64_t> warning_threshold;
+} ThresholdState;
+
+// Channel configuration shared by all channels
+typedef struct
+{
+    MEDIAN_MODE median_mode;                        // Median calculation mode
+    unsigned short pulse_width_lower_limit;         // Milliseconds
+    unsigned short pulse_width_upper_limit;         // Milliseconds
+    unsigned int window_capacity;                   // Maximum number of pulses in the window
+    uint64_t window_length;                         // Microseconds
+    uint64_t trend_window_lengths[MAX_TREND_WINDOWS];   // Longer windows fed by the same pulses (microseconds)
+    TREND_BACKEND trend_window_backends[MAX_TREND_WINDOWS]; // Backend of every trend window
+    unsigned int trend_window_count;                // Number of trend windows
+    unsigned int pulse_queue_capacity;              // Maximum number of pulses waiting to be processed
+    ThresholdState* threshold_state;                // Live alert thresholds
+    bool batch_ingest_flag;                         // Update the median once per drained batch rather than once per pulse
+} ChannelConfig;
+
+// Thermostat channel
+typedef struct
+{
+    unsigned int id;
+    const ChannelConfig* config;
+    PulseQueue queue;                   // Pulses waiting to be processed
+    MedianWindow window;                // Pulses of the window
+#ifdef VERIFY_MEDIAN
+    struct Node* head_ptr;              // Reference list implementation
+    MedianTracker median_tracker;
+#endif
+    AlertThresholds thresholds;         // Alert thresholds in effect, refreshed before every drain of the queue
+    unsigned int threshold_sequence;    // Sequence of the threshold state the thresholds were read at
+    unsigned int pulse_width_median;    // Calculated pulse width median times two
+    bool warning_alert_flag;            // Stores warning alert
+    uint64_t warning_alert_timestamp;   // Start of the current alert
+    AlertState alert_state;             // Commands the warnings of the channel
+    bool published_raised_flag;         // Alert last published (worker only)
+    bool published_held_flag;           // Alarm last published (worker only)
+    unsigned int observed_change_count; // Number of alert changes observed by the warning thread (warning thread only)
+    std::atomic<bool> acknowledge_flag; // Requests the acknowledgement of the alarm
+    bool raised_input_flag;             // Alert last fed to the state machine (warning thread only)
+    bool held_input_flag;               // Alarm last fed to the state machine (warning thread only)
+    STATE_MACHINE_STRUCT state_machine; // Governs the alarm and the intermittent activation of the warnings
+    uint64_t alert_latency_total;       // Sum of alert publication to warning thread latencies (microseconds)
+    uint64_t alert_latency_max;         // Largest alert publication to warning thread latency (microseconds)
+    unsigned long alert_change_count;   // Number of alert changes observed by the warning thread
+    unsigned long lost_change_count;    // Number of alert changes overwritten in the history before they were observed
+    unsigned long processed_count;      // Number of processed pulses
+    unsigned long above_threshold_count; // Number of processed pulses wider than the warning threshold
+    uint64_t wakeup_latency_total;      // Sum of pulse arrival to processing latencies (microseconds)
+    uint64_t wakeup_latency_max;        // Largest pulse arrival to processing latency (microseconds)
+    ChannelStats stats;                 // Stage latencies and counters
+} Channel;
+
+// Function declarations
+bool InitChannel(Channel* channel, unsigned int id, const ChannelConfig* config);
+void FreeChannel(Channel* channel);
+void ProcessChannelPulse(Channel* channel, Pulse pulse, FILE* fptr);
+void ProcessChannelPulseBatch(Channel* channel, const Pulse* pulses, unsigned int count, FILE* fptr);
+unsigned int ProcessChannelPulses(Channel* channel, FILE* fptr);
+void ReadChannelAlertState(Channel* channel, AlertSnapshot* snapshot);
+void InitThresholdState(ThresholdState* state, const AlertThresholds* thresholds);
+void PublishAlertThresholds(ThresholdState* state, const AlertThresholds* thresholds);
+unsigned int ReadAlertThresholds(ThresholdState* state, AlertThresholds* thresholds);
+void TickChannelWarnings(Channel* channel, FILE* fptr);
+void AcknowledgeChannelWarnings(Channel* channel);
@@ -0,0 +1,325 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements multi-channel worker pool
+
+#include <thread>
+
+#include "channel_pool.h"
+
+// Purpose: This function schedules a channel to a worker unless the channel is already scheduled
+// Params: A pointer to the pool, channel identifier and a pointer to the worker to schedule the channel to
+// Returns: True if the channel has been scheduled; false if it was already scheduled
+static bool ScheduleChannel(struct ChannelPool* pool, unsigned int channel_id, ChannelWorker* worker)
+{
+    bool scheduled = false;
+
+    if (!pool->scheduled_flags[channel_id].compare_exchange_strong(scheduled, true))
+        return false;
+
+    // A channel is scheduled at most once, hence the deque sized for all channels never overflows
+    PushWork(&worker->deque, channel_id);
+
+    return true;
+}
+
+// Purpose: This function retrieves the next channel to process, from the own deque first and then from the others
+// Params: A pointer to the worker and a pointer to the channel identifier
+// Returns: True if a channel has been retrieved; false if there is no work
+static bool FindWork(ChannelWorker* worker, unsigned int* channel_id)
+{
+    struct ChannelPool* pool = worker->pool;
+
+    if (PopWork(&worker->deque, channel_id))
+        return true;
+
+    if (pool->scheduling_mode == SCHEDULING_MODE_WORK_STEALING)
+    {
+        for (unsigned int i = 1; i < pool->worker_count; i++)
+        {
+            ChannelWorker* victim = &pool->workers[(worker->index + i) % pool->worker_count];
+
+            if (StealWork(&victim->deque, channel_id))
+            {
+                worker->stolen_count++;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Purpose: This function processes the channels scheduled to a worker, stealing work when allowed
+// It runs in a dedicated thread of execution
+static void RunChannelWorker(void* ptr)
+{
+    ChannelWorker* worker = (ChannelWorker*)ptr;
+    struct ChannelPool* pool = worker->pool;
+    unsigned int channel_id;
+
+    while (true)
+    {
+        uint64_t idle_timestamp = GetMonotonicTime();
+
+        // Block until work has been scheduled
+        worker->idle_flag.store(true);
+        WaitEvent(worker->wakeup_event, WAIT_FOREVER);
+        worker->idle_flag.store(false);
+
+        uint64_t busy_timestamp = GetMonotonicTime();
+        worker->idle_time += busy_timestamp - idle_timestamp;
+
+        if (pool->exit_flag.load(std::memory_order_acquire))
+            return;
+
+        while (FindWork(worker, &channel_id))
+        {
+            Channel* channel = &pool->channels[channel_id];
+
+            worker->processed_count += ProcessChannelPulses(channel, pool->fptr);
+            worker->executed_count++;
+
+            // Pulses submitted after the queue has been drained but before the channel is released 
+            // did not schedule the channel, hence the channel is rescheduled here
+            pool->scheduled_flags[channel_id].store(false);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!IsPulseQueueEmpty(&channel->queue))
+                ScheduleChannel(pool, channel_id, worker);
+        }
+
+        worker->busy_time += GetMonotonicTime() - busy_timestamp;
+    }
+}
+
+// Purpose: This function retrieves the default number of workers, one per core but no more than channels
+unsigned int GetDefaultWorkerCount(unsigned int channel_count)
+{
+    unsigned int core_count = std::thread::hardware_concurrency();
+
+    if (core_count == 0)
+        core_count = 1;
+
+    return (channel_count < core_count) ? channel_count : core_count;
+}
+
+// Purpose: This function initializes channel pool
+// Params: A pointer to the pool, number of channels, number of workers, scheduling mode, 
+// channel configuration (must outlive the pool) and the log file pointer
+// Returns: True if the pool storage has been allocated; false otherwise
+bool InitChannelPool(struct ChannelPool* pool, unsigned int channel_count, unsigned int worker_count, 
+    SCHEDULING_MODE scheduling_mode, const ChannelConfig* config, FILE* fptr)
+{
+    if ((channel_count == 0) || (worker_count == 0))
+        return false;
+
+    pool->channels = (Channel*)malloc(sizeof(Channel) * channel_count);
+    pool->scheduled_flags = (std::atomic<bool>*)malloc(sizeof(std::atomic<bool>) * channel_count);
+    pool->workers = (ChannelWorker*)malloc(sizeof(ChannelWorker) * worker_count);
+    pool->channel_count = 0;
+    pool->worker_count = 0;
+    pool->scheduling_mode = scheduling_mode;
+    pool->exit_flag.store(false, std::memory_order_relaxed);
+    pool->fptr = fptr;
+
+    if ((pool->channels == NULL) || (pool->scheduled_flags == NULL) || (pool->workers == NULL))
+    {
+        FreeChannelPool(pool);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < worker_count; i++)
+    {
+        ChannelWorker* worker = &pool->workers[i];
+
+        worker->pool = pool;
+        worker->index = i;
+        worker->thread = NULL;
+        worker->wakeup_event = NewEvent(false);
+        worker->idle_flag.store(false, std::memory_order_relaxed);
+        worker->processed_count = 0;
+        worker->executed_count = 0;
+        worker->stolen_count = 0;
+        worker->busy_time = 0;
+        worker->idle_time = 0;
+
+        bool initialized = InitWorkDeque(&worker->deque, channel_count) && (worker->wakeup_event != NULL);
+        pool->worker_count++;
+
+        if (!initialized)
+        {
+            FreeChannelPool(pool);
+            return false;
+        }
+    }
+
+    for (unsigned int id = 0; id < channel_count; id++)
+    {
+        pool->scheduled_flags[id].store(false, std::memory_order_relaxed);
+
+        if (!InitChannel(&pool->channels[id], id, config))
+        {
+            FreeChannelPool(pool);
+            return false;
+        }
+
+        pool->channel_count++;
+    }
+
+    return true;
+}
+
+// Purpose: This function starts the worker threads
+// Params: A pointer to the pool and the worker thread options (may be NULL for defaults), 
+// a processor given in the options pins worker i to that processor plus i
+// Returns: True if all workers have been started; false otherwise
+bool StartChannelPool(struct ChannelPool* pool, const ThreadOptions* options)
+{
+    ThreadOptions worker_options = { -1, PRIORITY_LEVEL_NORMAL };
+    bool started = true;
+
+    if (options != NULL)
+        worker_options = *options;
+
+    for (unsigned int i = 0; i < pool->worker_count; i++)
+    {
+        ThreadOptions thread_options = worker_options;
+
+        if (worker_options.cpu >= 0)
+            thread_options.cpu = worker_options.cpu + (int)i;
+
+        pool->workers[i].thread = StartThread(RunChannelWorker, &pool->workers[i], &thread_options);
+
+        if (pool->workers[i].thread == NULL)
+            started = false;
+    }
+
+    return started;
+}
+
+// Purpose: This function commands the worker threads to exit, waits for them to finish and processes the pulses they left behind
+// The producers of the pulses must have been stopped
+void StopChannelPool(struct ChannelPool* pool)
+{
+    pool->exit_flag.store(true, std::memory_order_release);
+
+    for (unsigned int i = 0; i < pool->worker_count; i++)
+    {
+        if (pool->workers[i].thread != NULL)
+        {
+            SignalEvent(pool->workers[i].wakeup_event);
+            JoinThread(pool->workers[i].thread);
+            pool->workers[i].thread = NULL;
+        }
+    }
+
+    // Process the pulses left in the queues once the workers have gone, so none is lost on shutdown
+    for (unsigned int id = 0; id < pool->channel_count; id++)
+        ProcessChannelPulses(&pool->channels[id], pool->fptr);
+}
+
+// Purpose: This function releases channel pool storage
+// The worker threads must have been stopped
+void FreeChannelPool(struct ChannelPool* pool)
+{
+    if (pool->channels != NULL)
+    {
+        for (unsigned int id = 0; id < pool->channel_count; id++)
+            FreeChannel(&pool->channels[id]);
+    }
+
+    if (pool->workers != NULL)
+    {
+        for (unsigned int i = 0; i < pool->worker_count; i++)
+        {
+            FreeWorkDeque(&pool->workers[i].deque);
+            FreeEvent(pool->workers[i].wakeup_event);
+        }
+    }
+
+    free(pool->channels);
+    free(pool->scheduled_flags);
+    free(pool->workers);
+
+    pool->channels = NULL;
+    pool->scheduled_flags = NULL;
+    pool->workers = NULL;
+    pool->channel_count = 0;
+    pool->worker_count = 0;
+}
+
+// Purpose: This function submits a pulse to a channel and schedules the channel to its home worker
+// In the work-stealing scheduling mode an idle worker is also woken up if the home worker is busy
+// Returns: True if the pulse has been queued; false if the channel queue is full and the pulse has been dropped
+bool SubmitChannelPulse(struct ChannelPool* pool, unsigned int channel_id, Pulse pulse)
+{
+    if (!EnqueuePulse(&pool->channels[channel_id].queue, pulse))
+        return false;
+
+    // Pairs with the release of the channel by the worker, so either the worker sees the pulse or the channel is scheduled here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    ChannelWorker* home = &pool->workers[channel_id % pool->worker_count];
+
+    if (!ScheduleChannel(pool, channel_id, home))
+        return true;
+
+    SignalEvent(home->wakeup_event);
+
+    if ((pool->scheduling_mode == SCHEDULING_MODE_WORK_STEALING) && !home->idle_flag.load())
+    {
+        for (unsigned int i = 1; i < pool->worker_count; i++)
+        {
+            ChannelWorker* worker = &pool->workers[(home->index + i) % pool->worker_count];
+
+            if (worker->idle_flag.load())
+            {
+                SignalEvent(worker->wakeup_event);
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Purpose: This function advances the state machines of all channels by one step
+// A single thread drives the state machines of every channel of the pool
+void TickChannelPoolWarnings(struct ChannelPool* pool)
+{
+    for (unsigned int id = 0; id < pool->channel_count; id++)
+        TickChannelWarnings(&pool->channels[id], pool->fptr);
+}
+
+// Purpose: This function requests the acknowledgement of the alarms of all channels
+// The requests are fed to the state machines by the next step of the warnings
+void AcknowledgeChannelPoolWarnings(struct ChannelPool* pool)
+{
+    for (unsigned int id = 0; id < pool->channel_count; id++)
+        AcknowledgeChannelWarnings(&pool->channels[id]);
+}
+
+// Purpose: This function prints the statistics of all channels
+// The statistics are read while the workers keep updating them, so the figures of a channel may be a few pulses apart
+void PrintChannelPoolStats(struct ChannelPool* pool)
+{
+#ifdef STATS_MODE
+    for (unsigned int id = 0; id < pool->channel_count; id++)
+    {
+        Channel* channel = &pool->channels[id];
+
+        PrintChannelStats(&channel->stats, id, GetDroppedPulses(&channel->queue), pool->fptr);
+    }
+#endif
+}
+
+// Purpose: This function calculates the fraction of time a worker has spent processing work items
+// The worker threads must have been stopped
+// Returns: Utilization in the range of [0, 1]
+double GetWorkerUtilization(const ChannelWorker* worker)
+{
+    uint64_t total_time = worker->busy_time + worker->idle_time;
+
+    return (total_time > 0) ? (double)worker->busy_time / total_time : 0.0;
+}
@@ -0,0 +1,75 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines multi-channel worker pool
+
+#pragma once
+
+#include <atomic>
+
+#include "functions.h"
+#include "channel.h"
+#include "work_deque.h"
+#include "platform.h"
+
+// The channel pool processes many thermostat channels with a fixed number of worker threads 
+// instead of dedicated threads per sensor. Every channel has a home worker: the worker whose index 
+// equals the channel identifier modulo the number of workers. Submitting a pulse queues it to its channel 
+// and, unless the channel is already scheduled, pushes the channel as a work item to the deque of its home 
+// worker and wakes it up. A channel is scheduled at most once at any time, so it is only ever processed by 
+// one worker at a time and every deque can hold all channels.
+// In the static scheduling mode a worker only processes the channels scheduled to its own deque.
+// In the work-stealing scheduling mode a worker that runs out of work steals the oldest work item 
+// from the deques of the other workers, and an idle worker is woken up whenever the home worker is busy, 
+// so a burst of pulses on the channels of one worker does not stall behind that worker.
+// The pulses of a channel must be submitted by a single thread, since the channel queue has a single producer.
+// Workers may be pinned to consecutive processors, worker i to the given processor plus i, and run at a raised priority.
+
+// Scheduling mode
+typedef enum
+{
+    SCHEDULING_MODE_STATIC,         // Channels are processed by their home worker only
+    SCHEDULING_MODE_WORK_STEALING   // Idle workers steal channels scheduled to busy workers
+} SCHEDULING_MODE;
+
+// Channel pool worker
+typedef struct
+{
+    struct ChannelPool* pool;
+    unsigned int index;
+    struct Thread* thread;
+    struct Event* wakeup_event;         // Auto-reset event signalled when work has been scheduled
+    WorkDeque deque;                    // Channels scheduled to the worker
+    std::atomic<bool> idle_flag;        // Set while the worker is waiting for work
+    unsigned long processed_count;      // Number of pulses processed by the worker
+    unsigned long executed_count;       // Number of work items executed by the worker
+    unsigned long stolen_count;         // Number of work items stolen from other workers
+    uint64_t busy_time;                 // Time spent processing work items (microseconds)
+    uint64_t idle_time;                 // Time spent waiting for work (microseconds)
+} ChannelWorker;
+
+// Multi-channel worker pool
+struct ChannelPool
+{
+    Channel* channels;
+    unsigned int channel_count;
+    std::atomic<bool>* scheduled_flags; // Set while a channel is scheduled to, or processed by, a worker
+    ChannelWorker* workers;
+    unsigned int worker_count;
+    SCHEDULING_MODE scheduling_mode;
+    std::atomic<bool> exit_flag;
+    FILE* fptr;
+};
+
+// Function declarations
+unsigned int GetDefaultWorkerCount(unsigned int channel_count);
+bool InitChannelPool(struct ChannelPool* pool, unsigned int channel_count, unsigned int worker_count, 
+    SCHEDULING_MODE scheduling_mode, const ChannelConfig* config, FILE* fptr);
+bool StartChannelPool(struct ChannelPool* pool, const ThreadOptions* options);
+void StopChannelPool(struct ChannelPool* pool);
+void FreeChannelPool(struct ChannelPool* pool);
+bool SubmitChannelPulse(struct ChannelPool* pool, unsigned int channel_id, Pulse pulse);
+void TickChannelPoolWarnings(struct ChannelPool* pool);
+void AcknowledgeChannelPoolWarnings(struct ChannelPool* pool);
+void PrintChannelPoolStats(struct ChannelPool* pool);
+double GetWorkerUtilization(const ChannelWorker* worker);
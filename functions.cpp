@@ -4,8 +4,21 @@
 // DESCRIPTION: This module implements functions
 
 #include "functions.h"
+#include "node_pool.h"
+#include "logger.h"
+#include "binary_log.h"
+#include "rolling_log.h"
+
+// Runtime log level
+static int log_level = LOG_LEVEL_TRACE;
+
+// Channel of the records written by the calling thread and whether its next text record starts a line
+static thread_local int log_channel = LOG_CHANNEL_NONE;
+static thread_local bool line_start_flag = true;
 
 // Purpose: This function retrieves current system time in milliseconds resolution
+// The system time is wall-clock time, which is subject to clock adjustments. 
+// Use GetMonotonicTime for measuring time intervals.
 uint64_t GetSystemTime()
 {
 #if defined(_WIN32) || defined(_WIN64)
@@ -13,112 +26,282 @@ uint64_t GetSystemTime()
     _ftime(&timebuffer);
     return (uint64_t)(((timebuffer.time * ONE_SEC) + timebuffer.millitm));
 #else
-    struct timeb timebuffer;
-    ftime(&timebuffer);
-    return (uint64_t)(((timebuffer.time * ONE_SEC) + timebuffer.millitm));
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)(((uint64_t)ts.tv_sec * ONE_SEC) + (ts.tv_nsec / 1000000));
+#endif
+}
+
+// Virtual time replaces the monotonic time while recorded pulses are replayed.
+// It is set by the replaying thread only, before and while it processes the pulses.
+static bool virtual_time_flag = false;
+static uint64_t virtual_time = 0;
+
+#if defined(_WIN32) || defined(_WIN64)
+// Purpose: This utility function retrieves the frequency of the performance counter, which is fixed at system boot
+static uint64_t QueryCounterFrequency()
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)frequency.QuadPart;
+}
+#endif
+
+// Purpose: This utility function reads the monotonic clock of the system in nanoseconds
+// Both monotonic times are derived from it, so they always agree
+static uint64_t ReadMonotonicClock()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    // The static initializer runs once, so the threads never race to read the frequency
+    static const uint64_t frequency = QueryCounterFrequency();
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+
+    // Split the conversion to avoid overflow of the intermediate product
+    uint64_t seconds = (uint64_t)counter.QuadPart / frequency;
+    uint64_t remainder = (uint64_t)counter.QuadPart % frequency;
+
+    return (seconds * 1000000000ull) + ((remainder * 1000000000ull) / frequency);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
 #endif
 }
 
+// Purpose: This function retrieves monotonic time in microseconds resolution
+// The monotonic time never steps backwards or jumps with the wall-clock adjustments, 
+// hence it is used for all internal timing (pulse timestamps, stale pulse eviction, timeouts)
+// Returns: The monotonic time, or the virtual time once it has been set
+uint64_t GetMonotonicTime()
+{
+    if (virtual_time_flag)
+        return virtual_time;
+
+    return ReadMonotonicClock() / 1000;
+}
+
+// Purpose: This function switches the monotonic time over to virtual time and sets it
+// Params: Virtual time (microseconds), which must never step backwards
+void SetVirtualTime(uint64_t time)
+{
+    virtual_time = time;
+    virtual_time_flag = true;
+}
+
+// Purpose: This function checks to see whether the monotonic time has been switched over to virtual time
+bool IsVirtualTime()
+{
+    return virtual_time_flag;
+}
+
+// Purpose: This function retrieves monotonic time in nanoseconds resolution
+// It is used for timing the processing stages, which take far less than a microsecond. 
+// Unlike the monotonic time in microseconds, it measures real time even while pulses are replayed in virtual time.
+uint64_t GetMonotonicTimeNs()
+{
+    return ReadMonotonicClock();
+}
+
 // Purpose: This function creates timestamp for log file
-char* CreateLogFileTimeStamp()
+// Params: A buffer for the timestamp and its size, LOG_TIMESTAMP_SIZE fits the whole timestamp
+void CreateLogFileTimeStamp(char* timestamp, unsigned int size)
 {
     time_t rawtime = time(NULL);
     struct tm* ptm = localtime(&rawtime);
-    char* timestamp = (char*)malloc(sizeof(char) * 20);
 
-    if (timestamp != NULL)
-    {
-        sprintf(timestamp, "%04d_%02d_%02d_%02d_%02d_%02d",
-            ptm->tm_year + 1900, ptm->tm_mon + 1, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
-    }
-
-    return timestamp;
+    snprintf(timestamp, size, "%04d_%02d_%02d_%02d_%02d_%02d",
+        ptm->tm_year + 1900, ptm->tm_mon + 1, ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
 }
 
 // Purpose: This utility function creates a new node
-struct Node* MakeNode(Pulse pulse)
+// Params: A node pool to draw the node from (if NULL, the node is allocated on the heap) and a pulse
+struct Node* MakeNode(struct NodePool* pool, Pulse pulse)
 {
-    struct Node* new_node_ptr = (struct Node*)malloc(sizeof(struct Node));
+    struct Node* new_node_ptr = (pool != NULL) ? TakeNode(pool) : (struct Node*)malloc(sizeof(struct Node));
 
     if (new_node_ptr != NULL)
     {
         new_node_ptr->pulse = pulse;
         new_node_ptr->next = NULL;
+        new_node_ptr->prev = NULL;
     }
 
     return new_node_ptr;
 }
 
+// Purpose: This utility function releases a node
+// Params: A node pool the node has been drawn from (if NULL, the node is released to the heap) and a node
+void FreeNode(struct NodePool* pool, struct Node* node_ptr)
+{
+    if (pool != NULL)
+        ReturnNode(pool, node_ptr);
+    else
+        free(node_ptr);
+}
+
+// Purpose: This utility function shifts the tracked median after a node has been inserted
+// Params: A pointer to the tracker, the inserted node and whether it has been inserted after the median node
+static void TrackInsertedNode(MedianTracker* tracker, struct Node* node_ptr, bool after_median)
+{
+    if (tracker->count == 0)
+    {
+        tracker->median_ptr = node_ptr;
+    }
+    else if ((!after_median) && ((tracker->count % 2) == 1))
+    {
+        tracker->median_ptr = tracker->median_ptr->prev;
+    }
+    else if (after_median && ((tracker->count % 2) == 0))
+    {
+        tracker->median_ptr = tracker->median_ptr->next;
+    }
+
+    tracker->count++;
+}
+
+// Purpose: This utility function shifts the tracked median before a node is deleted
+// Params: A pointer to the tracker, the node to delete and whether it precedes the median node
+static void TrackDeletedNode(MedianTracker* tracker, struct Node* node_ptr, bool before_median)
+{
+    if (node_ptr == tracker->median_ptr)
+    {
+        tracker->median_ptr = ((tracker->count % 2) == 1) ? node_ptr->prev : node_ptr->next;
+    }
+    else if (before_median && ((tracker->count % 2) == 0))
+    {
+        tracker->median_ptr = tracker->median_ptr->next;
+    }
+    else if ((!before_median) && ((tracker->count % 2) == 1))
+    {
+        tracker->median_ptr = tracker->median_ptr->prev;
+    }
+
+    tracker->count--;
+}
+
+// Purpose: This function initializes incremental median tracker of an empty list
+void InitMedianTracker(MedianTracker* tracker)
+{
+    tracker->median_ptr = NULL;
+    tracker->count = 0;
+}
+
 // Purpose: This function inserts a new node in the list in the ascending order 
-// Params: A pointer to the head of a list and an element to add
-void InsertPulse(struct Node** head_ptr, struct Node* new_node_ptr)
+// Params: A pointer to the head of a list, an element to add and the median tracker of the list (may be NULL)
+void InsertPulse(struct Node** head_ptr, struct Node* new_node_ptr, MedianTracker* tracker)
 {
     if (new_node_ptr != NULL)
     {
+        bool after_median = false;
+
         // Special case for the head
         if ((*head_ptr == NULL) || ((*head_ptr)->pulse.width >= new_node_ptr->pulse.width))
         {
             new_node_ptr->next = *head_ptr;
+            new_node_ptr->prev = NULL;
+
+            if (*head_ptr != NULL)
+                (*head_ptr)->prev = new_node_ptr;
+
             *head_ptr = new_node_ptr;
         }
         else
         {
-            // Locate the node before the place of insertion
+            // Locate the node before the place of insertion, noting whether the median node is passed on the way
             struct Node* curr_ptr = *head_ptr;
 
+            after_median = (tracker != NULL) && (curr_ptr == tracker->median_ptr);
+
             while ((curr_ptr->next != NULL) && (curr_ptr->next->pulse.width < new_node_ptr->pulse.width))
             {
                 curr_ptr = curr_ptr->next;
+
+                if ((tracker != NULL) && (curr_ptr == tracker->median_ptr))
+                    after_median = true;
             }
 
             new_node_ptr->next = curr_ptr->next;
+            new_node_ptr->prev = curr_ptr;
+
+            if (curr_ptr->next != NULL)
+                curr_ptr->next->prev = new_node_ptr;
+
             curr_ptr->next = new_node_ptr;
         }
+
+        if (tracker != NULL)
+            TrackInsertedNode(tracker, new_node_ptr, after_median);
     }
 }
 
 // Purpose: This function traverses a list and deletes nodes with stale data, if any are found
-// Nodes with stale data have their timestamp values smaller by at least 1000 milliseconds 
+// Nodes with stale data have their timestamp values smaller by more than the window length 
 // than that of the new node to be inserted
-// Params: A pointer to the head of a list and a new node with the youngest timestamp
+// Params: A pointer to the head of a list, the youngest timestamp, window length (microseconds), 
+// a node pool the nodes have been drawn from (NULL for heap allocated nodes) 
+// and the median tracker of the list (may be NULL)
 // Returns: The updated head of the list
-struct Node* DeleteStalePulses(struct Node* head_ptr, uint64_t timestamp, FILE* fptr)
+struct Node* DeleteStalePulses(struct Node* head_ptr, uint64_t timestamp, uint64_t window_length, 
+    struct NodePool* pool, MedianTracker* tracker, FILE* fptr)
 {
     if (head_ptr == NULL)
         return NULL;
 
-    PrintStr("Stale: ", fptr);
+    // Compile-time false if trace records are compiled out
+    const bool trace_flag = LOG_ENABLED(LOG_LEVEL_TRACE);
 
-    // Until the head data is equal to the key move the head pointer
-    while ((head_ptr != NULL) && ((head_ptr->pulse.timestamp + ONE_SEC) < timestamp))
-    {
-        struct Node* tmp = head_ptr;
-        head_ptr = head_ptr->next;
-        free(tmp);
-    }
+    if (trace_flag)
+        PrintStr("Stale: ", fptr);
 
-    struct Node* curr_ptr = head_ptr, * prev_ptr = head_ptr;
+    // Set once the traversal has gone past the median node
+    bool median_passed = false;
+
+    struct Node* curr_ptr = head_ptr;
 
     while (curr_ptr != NULL)
     {
-        if ((curr_ptr->pulse.timestamp + ONE_SEC) < timestamp)
+        struct Node* next_ptr = curr_ptr->next;
+
+        if ((curr_ptr->pulse.timestamp + window_length) < timestamp)
         {
-            prev_ptr->next = curr_ptr->next;
+            if (tracker != NULL)
+            {
+                bool median_flag = (curr_ptr == tracker->median_ptr);
 
-            PrintTemp(curr_ptr->pulse.temp, fptr);
+                TrackDeletedNode(tracker, curr_ptr, !median_passed);
+
+                // The median moves either to the previous node, which has been passed, or to the next one
+                if (median_flag)
+                    median_passed = (tracker->median_ptr != next_ptr);
+            }
 
-            struct Node* tmp = curr_ptr;
-            curr_ptr = curr_ptr->next;
-            free(tmp);
+            if (curr_ptr->prev != NULL)
+                curr_ptr->prev->next = next_ptr;
+            else
+                head_ptr = next_ptr;
+
+            if (next_ptr != NULL)
+                next_ptr->prev = curr_ptr->prev;
+
+            if (trace_flag)
+                PrintTemp(ConvertDoubledPulseWidthToTemp(2u * curr_ptr->pulse.width), fptr);
+
+            LogBinaryRecord(RECORD_STALE_PULSE, curr_ptr->pulse.width, 0, curr_ptr->pulse.timestamp, fptr);
+
+            FreeNode(pool, curr_ptr);
         }
-        else
+        else if ((tracker != NULL) && (curr_ptr == tracker->median_ptr))
         {
-            prev_ptr = curr_ptr;
-            curr_ptr = curr_ptr->next;
+            median_passed = true;
         }
+
+        curr_ptr = next_ptr;
     }
 
-    PrintStr("\n", fptr);
+    if (trace_flag)
+        PrintStr("\n", fptr);
 
     return head_ptr;
 }
@@ -127,12 +310,15 @@ struct Node* DeleteStalePulses(struct Node* head_ptr, uint64_t timestamp, FILE*
 // Params: A pointer to a node in a list
 void PrintList(struct Node* node_ptr, FILE* fptr)
 {
-#ifdef PRINTF_MODE
+#if defined(PRINTF_MODE) && (LOG_MIN_LEVEL <= LOG_LEVEL_TRACE)
+    if (!LOG_ENABLED(LOG_LEVEL_TRACE))
+        return;
+
     PrintStr("List:  ", fptr);
 
     while (node_ptr != NULL)
     {
-        PrintTemp(node_ptr->pulse.temp, fptr);
+        PrintTemp(ConvertDoubledPulseWidthToTemp(2u * node_ptr->pulse.width), fptr);
         node_ptr = node_ptr->next;
     }
 
@@ -142,47 +328,22 @@ void PrintList(struct Node* node_ptr, FILE* fptr)
 }
 
 
-// Purpose: This function finds a median value in a list
-// Params: A pointer to the head of a list
-double FindMedian(Node* head_ptr)
+// Purpose: This function retrieves the median value of a list from its tracker
+// The median is doubled to represent even-count averages exactly in integers
+// Params: A pointer to the median tracker of a list
+// Returns: Twice the median pulse width or 0 if the list is empty
+unsigned int FindMedian(const MedianTracker* tracker)
 {
-    double median = 0;
+    const struct Node* median_ptr = tracker->median_ptr;
 
-    Node* slow_ptr = head_ptr;
-    Node* fast_ptr = head_ptr;
-    Node* slow_ptr_prev = head_ptr;
+    if (median_ptr == NULL)
+        return 0;
 
-    if (head_ptr != NULL)
-    {
-        while ((fast_ptr != NULL) && (fast_ptr->next != NULL))
-        {
-            fast_ptr = fast_ptr->next->next;
-            slow_ptr_prev = slow_ptr;
-            slow_ptr = slow_ptr->next;
-        }
+    // The list contains odd number of nodes. Hence, simply return the middle element
+    if ((tracker->count % 2) == 1)
+        return 2u * median_ptr->pulse.width;
 
-        // If the below condition evaluates to true, the linked list contains odd number of nodes.
-        // Hence, simply return the middle element
-        if (fast_ptr != NULL)
-        {
-            median = slow_ptr->pulse.width;
-        }
-        else // The linked list contains even number of nodes
-        {
-            median = double(slow_ptr->pulse.width + slow_ptr_prev->pulse.width) / 2.0;
-        }
-    }
-
-    return median;
-}
-
-// Purpose: This function simulates generation of electrical pulse signal width by a 
-// temperature measuring sensor that is converted to a corresponding temperature value
-// Input: Valid signal range boundaries (positive integers)
-// Output: Electrical pulse width (milliseconds)
-unsigned short GeneratePulseWidth(unsigned short lower, unsigned short upper)
-{
-    return (rand() % (upper - lower + 1)) + lower;
+    return (unsigned int)median_ptr->pulse.width + median_ptr->next->pulse.width;
 }
 
 // Purpose: This function converts an electrical pulse width to its corresponding temperature value
@@ -190,10 +351,22 @@ unsigned short GeneratePulseWidth(unsigned short lower, unsigned short upper)
 // Output: Temperature value (degrees Celsius)
 double ConvertPulseWidthToTemp(double pulse_width)
 {
-    const unsigned short offset = 5;
-    const double scale_factor = 1.3333;
+    return ThermostatCalibration::ConvertToTemp(pulse_width);
+}
+
+// Purpose: This function converts a doubled electrical pulse width (e.g. a median) to its corresponding temperature value
+// Temperatures of the valid signal range are looked up in a table generated at compile time
+// Input: Twice the electrical pulse width (milliseconds)
+// Output: Temperature value (degrees Celsius)
+double ConvertDoubledPulseWidthToTemp(unsigned int doubled_pulse_width)
+{
+    static constexpr SensorTempTable<2u * (pulse_width_upper_limit - pulse_width_lower_limit) + 1u> temp_table = 
+        ThermostatCalibration::MakeTempTable<pulse_width_lower_limit, pulse_width_upper_limit>();
 
-    return (pulse_width - offset) * scale_factor;
+    if ((doubled_pulse_width >= 2u * pulse_width_lower_limit) && (doubled_pulse_width <= 2u * pulse_width_upper_limit))
+        return temp_table.temps[doubled_pulse_width - 2u * pulse_width_lower_limit];
+
+    return ThermostatCalibration::ConvertToTemp(doubled_pulse_width / 2.0);
 }
 
 // Purpose: This function converts a temperature value to an electrical pulse width
@@ -201,10 +374,7 @@ double ConvertPulseWidthToTemp(double pulse_width)
 // Output: Electrical pulse width (milliseconds)
 unsigned short ConvertTemperatureToPulseWidth(unsigned short temp_val)
 {
-    const unsigned short offset = 5;
-    const double scale_factor = 0.75;
-
-    return (unsigned short)(temp_val * scale_factor) + offset;
+    return (unsigned short)ThermostatCalibration::ConvertToPulseWidth(temp_val);
 }
 
 // Purpose: This function checks to see whether predefined time limit has been reached or surpassed (timeout expired)
@@ -220,48 +390,165 @@ bool IsTimeout(uint64_t current_time, uint64_t start_time, uint64_t limit_time)
 // These state functions below are only stubs that do not do anything. Real life state functions do real life things.
 void Warning_On(FILE* fptr)
 {
-#ifdef PRINTF_MODE
-    printf("\tWarning On\n");
+    if (LOG_ENABLED(LOG_LEVEL_ALERT))
+        PrintStr("\tWarning On\n", fptr);
 
-    if (fptr != NULL)
-        fprintf(fptr, "\tWarning On\n");
-#endif
+    LogBinaryRecord(RECORD_WARNING_ON, 0, 0, GetMonotonicTime(), fptr);
 }
 
 void Warning_Off(FILE* fptr)
 {
-#ifdef PRINTF_MODE
-    printf("\tWarning Off\n");
+    if (LOG_ENABLED(LOG_LEVEL_ALERT))
+        PrintStr("\tWarning Off\n", fptr);
 
-    if (fptr != NULL)
-        fprintf(fptr, "\tWarning Off\n");
-#endif
+    LogBinaryRecord(RECORD_WARNING_OFF, 0, 0, GetMonotonicTime(), fptr);
+}
+
+void Alarm_Idle(FILE* fptr)
+{
+    if (LOG_ENABLED(LOG_LEVEL_ALERT))
+        PrintStr("\tIdle\n", fptr);
+
+    LogBinaryRecord(RECORD_IDLE, 0, 0, GetMonotonicTime(), fptr);
+}
+
+void Pre_Alarm(FILE* fptr)
+{
+    if (LOG_ENABLED(LOG_LEVEL_ALERT))
+        PrintStr("\tPre-alarm\n", fptr);
+
+    LogBinaryRecord(RECORD_PRE_ALARM, 0, 0, GetMonotonicTime(), fptr);
+}
+
+void Alarm_Latched(FILE* fptr)
+{
+    if (LOG_ENABLED(LOG_LEVEL_ALERT))
+        PrintStr("\tLatched\n", fptr);
+
+    LogBinaryRecord(RECORD_LATCHED, 0, 0, GetMonotonicTime(), fptr);
+}
+
+void Alarm_Acknowledged(FILE* fptr)
+{
+    if (LOG_ENABLED(LOG_LEVEL_ALERT))
+        PrintStr("\tAcknowledged\n", fptr);
+
+    LogBinaryRecord(RECORD_ACKNOWLEDGED, 0, 0, GetMonotonicTime(), fptr);
+}
+
+// Purpose: This function sets the runtime log level
+// Params: The lowest log level to output (LOG_LEVEL_TRACE to LOG_LEVEL_NONE)
+void SetLogLevel(int level)
+{
+    log_level = level;
+}
+
+// Purpose: This function retrieves the runtime log level
+int GetLogLevel()
+{
+    return log_level;
+}
+
+// Purpose: This function checks whether records of the given log level are output
+bool IsLogLevelEnabled(int level)
+{
+    return (level >= log_level);
+}
+
+// Purpose: This function sets the channel of the records written by the calling thread
+// Params: Channel identifier or LOG_CHANNEL_NONE
+void SetLogChannel(int channel)
+{
+    log_channel = channel;
+}
+
+// Purpose: This function retrieves the channel of the records written by the calling thread
+int GetLogChannel()
+{
+    return log_channel;
+}
+
+// Purpose: This utility function outputs a formatted record
+// If the logger is running, the record is handed over to the logging thread, which writes it 
+// to the console and the log file; otherwise it is written directly.
+// While the binary log sink is selected, text records are only written to the console 
+// and only if the logger is not running.
+static void WriteRecord(const char* str, unsigned int len, FILE* fptr)
+{
+    if (GetLogSink() == LOG_SINK_BINARY)
+    {
+        if (!IsLoggerRunning())
+            fwrite(str, 1, len, stdout);
+
+        return;
+    }
+
+    if ((fptr != NULL) && IsLoggerRunning())
+    {
+        LogWrite(str, len);
+        return;
+    }
+
+    fwrite(str, 1, len, stdout);
+
+    WriteLogFile(str, len, fptr);
+}
+
+// Purpose: This utility function outputs a formatted record, starting every line of a channel with its identifier
+static void PrintRecord(const char* str, unsigned int len, FILE* fptr)
+{
+    if (len == 0)
+        return;
+
+    if (line_start_flag && (log_channel != LOG_CHANNEL_NONE))
+    {
+        char prefix[16];
+        int prefix_len = snprintf(prefix, sizeof(prefix), "[%d] ", log_channel);
+
+        WriteRecord(prefix, (unsigned int)prefix_len, fptr);
+    }
+
+    WriteRecord(str, len, fptr);
+
+    line_start_flag = (str[len - 1] == '\n');
 }
 
 void PrintInt(int val, FILE* fptr)
 {
 #ifdef PRINTF_MODE
-    printf(" %d", val);
-    if (fptr != NULL)
-        fprintf(fptr, " %d", val);
+    char str[16];
+    int len = snprintf(str, sizeof(str), " %d", val);
+
+    PrintRecord(str, (unsigned int)len, fptr);
+#endif  
+}
+
+void PrintUInt64(uint64_t val, FILE* fptr)
+{
+#ifdef PRINTF_MODE
+    char str[24];
+    int len = snprintf(str, sizeof(str), " %" PRIu64, val);
+
+    PrintRecord(str, (unsigned int)len, fptr);
 #endif  
 }
 
 void PrintTemp(double val, FILE* fptr)
 {
 #ifdef PRINTF_MODE
-    printf(" %4.1f", val);
-    if (fptr != NULL)
-        fprintf(fptr, " %4.1f", val);
+    char str[32];
+    int len = snprintf(str, sizeof(str), " %4.1f", val);
+
+    if (len >= (int)sizeof(str))
+        len = sizeof(str) - 1;
+
+    PrintRecord(str, (unsigned int)len, fptr);
 #endif  
 }
 
 void PrintStr(const char* str, FILE* fptr)
 {
 #ifdef PRINTF_MODE
-    printf(str);
-    if (fptr != NULL)
-        fprintf(fptr, str);
-
+    PrintRecord(str, (unsigned int)strlen(str), fptr);
 #endif  
-}
\ No newline at end of file
+}
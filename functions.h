@@ -8,21 +8,50 @@
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include<windows.h>
+#include <string.h>
+#include <stdint.h>
 #include <inttypes.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
 #include <sys/timeb.h>
+#endif
+
+#include "sensor_calibration.h"
+
+#define ONE_SEC 1000                // Milliseconds
+#define ONE_MSEC_IN_USEC 1000       // Microseconds
+#define ONE_SEC_IN_USEC 1000000     // Microseconds
 
-#define ONE_SEC 1000
+#define LOG_TIMESTAMP_SIZE 20       // Log file timestamp length, including the terminator
 
 #define PRINTF_MODE
 
+// Log verbosity levels. Records below the runtime log level are skipped before any formatting happens.
+// Records below the compile-time minimum log level are compiled out altogether.
+#define LOG_LEVEL_TRACE     0   // Window dumps and stale pulses
+#define LOG_LEVEL_PULSE     1   // New pulses
+#define LOG_LEVEL_MEDIAN    2   // Medians
+#define LOG_LEVEL_ALERT     3   // Alerts and warning transitions
+#define LOG_LEVEL_NONE      4   // Nothing
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#endif
+
+// Evaluates to a compile-time false for records below the compile-time minimum log level
+#define LOG_ENABLED(level) (((level) >= LOG_MIN_LEVEL) && IsLogLevelEnabled(level))
+
+// Records belong to the channel set by the thread that writes them: every text line of a channel 
+// starts with the channel identifier in brackets, e.g. "[2] Median: 63.3", and every binary record carries it
+#define LOG_CHANNEL_NONE    -1  // Records of no channel, e.g. the final report
+
 // Linked list data
 typedef struct
 {
     bool valid;
-    unsigned short width;
-    double temp;
-    uint64_t timestamp;
+    unsigned short width;   // Milliseconds
+    uint64_t timestamp;     // Monotonic time (microseconds)
 } Pulse;
 
 // Linked list node
@@ -30,22 +59,52 @@ struct Node
 {
     Pulse pulse;
     struct Node* next;
+    struct Node* prev;
 };
 
+// Incremental median tracker of a sorted list
+// Inserting or deleting a node shifts the median position by at most one node, so the tracker 
+// follows it with the node links instead of walking to the middle of the list after every update
+typedef struct
+{
+    struct Node* median_ptr;    // Lower middle node, i.e. the node with zero-based rank (count - 1) / 2
+    unsigned int count;         // Number of nodes in the list
+} MedianTracker;
+
+// Linked list node pool (see node_pool.h)
+struct NodePool;
+
 // Function declarations
 uint64_t GetSystemTime();
-char* CreateLogFileTimeStamp();
-struct Node* MakeNode(Pulse pulse);
-void InsertPulse(struct Node** head_ptr, struct Node* new_node_ptr);
-struct Node* DeleteStalePulses(struct Node* head_ptr, uint64_t timestamp, FILE* fptr);
+uint64_t GetMonotonicTime();
+uint64_t GetMonotonicTimeNs();
+void SetVirtualTime(uint64_t time);
+bool IsVirtualTime();
+void CreateLogFileTimeStamp(char* timestamp, unsigned int size);
+struct Node* MakeNode(struct NodePool* pool, Pulse pulse);
+void FreeNode(struct NodePool* pool, struct Node* node_ptr);
+void InitMedianTracker(MedianTracker* tracker);
+void InsertPulse(struct Node** head_ptr, struct Node* new_node_ptr, MedianTracker* tracker);
+struct Node* DeleteStalePulses(struct Node* head_ptr, uint64_t timestamp, uint64_t window_length, 
+    struct NodePool* pool, MedianTracker* tracker, FILE* fptr);
 void PrintList(struct Node* node_ptr, FILE* fptr);
-unsigned short GeneratePulseWidth(unsigned short lower, unsigned short upper);
 unsigned short ConvertTemperatureToPulseWidth(unsigned short temp_val);
 bool IsTimeout(uint64_t current_time, uint64_t start_time, uint64_t limit_time);
 double ConvertPulseWidthToTemp(double pulse_width);
-double FindMedian(Node* head_ptr);
+double ConvertDoubledPulseWidthToTemp(unsigned int doubled_pulse_width);
+unsigned int FindMedian(const MedianTracker* tracker);
+void SetLogLevel(int level);
+int GetLogLevel();
+bool IsLogLevelEnabled(int level);
+void SetLogChannel(int channel);
+int GetLogChannel();
 void PrintInt(int val, FILE* fptr);
+void PrintUInt64(uint64_t val, FILE* fptr);
 void PrintTemp(double val, FILE* fptr);
 void PrintStr(const char* str, FILE* fptr);
 void Warning_On(FILE* fptr);
-void Warning_Off(FILE* fptr);
\ No newline at end of file
+void Warning_Off(FILE* fptr);
+void Alarm_Idle(FILE* fptr);
+void Pre_Alarm(FILE* fptr);
+void Alarm_Latched(FILE* fptr);
+void Alarm_Acknowledged(FILE* fptr);
\ No newline at end of file
@@ -0,0 +1,307 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements histogram based sliding window median
+
+#include "histogram_median.h"
+#include "binary_log.h"
+#include "pulse_kernels.h"
+
+// Purpose: This utility function maps a pulse width to its histogram bin
+// Pulse widths outside of the configured range are counted in the boundary bins
+static unsigned int GetBin(const HistogramMedian* histogram_median, unsigned short width)
+{
+    if (width < histogram_median->lower)
+        width = histogram_median->lower;
+    else if (width > histogram_median->upper)
+        width = histogram_median->upper;
+
+    return width - histogram_median->lower;
+}
+
+// Purpose: This utility function removes the oldest pulse of a window from its histogram
+static void RemoveOldestWindowPulse(HistogramMedian* histogram_median, HistogramWindow* window)
+{
+    unsigned int slot = GetSlotByAge(&histogram_median->ring, histogram_median->ring.count - window->count);
+
+    window->bins[histogram_median->ring.indices[slot]]--;
+    window->count--;
+}
+
+// Purpose: This utility function drops the oldest pulses of the ring that have left every window
+static void TrimRing(HistogramMedian* histogram_median)
+{
+    unsigned int max_count = 0;
+
+    for (unsigned int i = 0; i < histogram_median->window_count; i++)
+    {
+        if (histogram_median->windows[i].count > max_count)
+            max_count = histogram_median->windows[i].count;
+    }
+
+    while (histogram_median->ring.count > max_count)
+        PopOldestPulse(&histogram_median->ring);
+}
+
+// Purpose: This function initializes histogram based sliding window median
+// Params: A pointer to the histogram, pulse width range boundaries (milliseconds), 
+// maximum number of pulses in the window and window length of the primary window (microseconds)
+// Returns: True if the histogram storage has been allocated; false otherwise
+bool InitHistogramMedian(HistogramMedian* histogram_median, unsigned short lower, unsigned short upper, 
+    unsigned int capacity, uint64_t window_length)
+{
+    if (upper < lower)
+        upper = lower;
+
+    histogram_median->lower = lower;
+    histogram_median->upper = upper;
+    histogram_median->window_count = 0;
+    histogram_median->truncated_count = 0;
+
+    if ((!InitPulseRing(&histogram_median->ring, capacity)) || (!AddHistogramWindow(histogram_median, window_length)))
+    {
+        FreeHistogramMedian(histogram_median);
+        return false;
+    }
+
+    return true;
+}
+
+// Purpose: This function releases histogram based sliding window median storage
+void FreeHistogramMedian(HistogramMedian* histogram_median)
+{
+    for (unsigned int i = 0; i < histogram_median->window_count; i++)
+    {
+        free(histogram_median->windows[i].bins);
+        histogram_median->windows[i].bins = NULL;
+    }
+
+    FreePulseRing(&histogram_median->ring);
+
+    histogram_median->window_count = 0;
+}
+
+// Purpose: This function adds a window of another length over the shared ring
+// A window added after pulses have been added starts empty
+// Params: A pointer to the histogram and window length (microseconds)
+// Returns: True if the window has been added; false if there is no room for it or its storage cannot be allocated
+bool AddHistogramWindow(HistogramMedian* histogram_median, uint64_t window_length)
+{
+    if (histogram_median->window_count == MAX_HISTOGRAM_WINDOWS)
+        return false;
+
+    HistogramWindow* window = &histogram_median->windows[histogram_median->window_count];
+
+    window->bins = (unsigned int*)calloc(histogram_median->upper - histogram_median->lower + 1, sizeof(unsigned int));
+    window->count = 0;
+    window->window_length = window_length;
+
+    if (window->bins == NULL)
+        return false;
+
+    histogram_median->window_count++;
+
+    return true;
+}
+
+// Purpose: This function evicts pulses with stale data, if any are found
+// Pulses with stale data have their timestamp values smaller by more than the window length 
+// than that of the new pulse to be added. Every window advances its own eviction cursor; 
+// only the pulses evicted from the primary window are logged.
+// Params: A pointer to the histogram and the youngest timestamp
+// Returns: The number of pulses evicted from the primary window
+unsigned int EvictStaleHistogramPulses(HistogramMedian* histogram_median, uint64_t timestamp, FILE* fptr)
+{
+    unsigned int evicted = 0;
+
+    if (histogram_median->ring.count == 0)
+        return 0;
+
+    // Compile-time false if trace records are compiled out
+    const bool trace_flag = LOG_ENABLED(LOG_LEVEL_TRACE);
+
+    if (trace_flag)
+        PrintStr("Stale: ", fptr);
+
+    for (unsigned int i = 0; i < histogram_median->window_count; i++)
+    {
+        HistogramWindow* window = &histogram_median->windows[i];
+
+        while (window->count > 0)
+        {
+            unsigned int slot = GetSlotByAge(&histogram_median->ring, histogram_median->ring.count - window->count);
+
+            if ((histogram_median->ring.timestamps[slot] + window->window_length) >= timestamp)
+                break;
+
+            if (i == 0)
+            {
+                if (trace_flag)
+                    PrintTemp(ConvertDoubledPulseWidthToTemp(2u * histogram_median->ring.widths[slot]), fptr);
+
+                LogBinaryRecord(RECORD_STALE_PULSE, histogram_median->ring.widths[slot], 0, histogram_median->ring.timestamps[slot], fptr);
+                evicted++;
+            }
+
+            RemoveOldestWindowPulse(histogram_median, window);
+        }
+    }
+
+    TrimRing(histogram_median);
+
+    if (trace_flag)
+        PrintStr("\n", fptr);
+
+    return evicted;
+}
+
+// Purpose: This function adds a new pulse to every window
+// If the ring is full, the oldest pulse is dropped from every window to make room for the new one 
+// and counted as truncated. As with the evictions, a pulse dropped from the primary window is recorded 
+// in the binary log as a stale pulse, so that a converted log accounts for it.
+// Params: A pointer to the histogram, a pulse with the youngest timestamp and the log file pointer
+void AddHistogramPulse(HistogramMedian* histogram_median, Pulse pulse, FILE* fptr)
+{
+    if (histogram_median->ring.capacity == 0)
+        return;
+
+    if (IsPulseRingFull(&histogram_median->ring))
+    {
+        unsigned int slot = GetSlotByAge(&histogram_median->ring, 0);
+
+        if (histogram_median->windows[0].count == histogram_median->ring.count)
+            LogBinaryRecord(RECORD_STALE_PULSE, histogram_median->ring.widths[slot], 0, histogram_median->ring.timestamps[slot], fptr);
+
+        for (unsigned int i = 0; i < histogram_median->window_count; i++)
+        {
+            if (histogram_median->windows[i].count == histogram_median->ring.count)
+                RemoveOldestWindowPulse(histogram_median, &histogram_median->windows[i]);
+        }
+
+        PopOldestPulse(&histogram_median->ring);
+        histogram_median->truncated_count++;
+    }
+
+    unsigned int bin = GetBin(histogram_median, pulse.width);
+
+    histogram_median->ring.indices[PushPulse(&histogram_median->ring, pulse)] = bin;
+
+    for (unsigned int i = 0; i < histogram_median->window_count; i++)
+    {
+        histogram_median->windows[i].bins[bin]++;
+        histogram_median->windows[i].count++;
+    }
+}
+
+// Purpose: This function retrieves the median pulse width of the primary window
+// Returns: Twice the median pulse width or 0 if the window is empty
+unsigned int GetHistogramMedian(const HistogramMedian* histogram_median)
+{
+    return GetHistogramWindowMedian(histogram_median, 0);
+}
+
+// Purpose: This function retrieves the median pulse width of a window
+// The bins are walked from the smallest pulse width until both middle elements are found
+// Params: A pointer to the histogram and the window index (0 for the primary window)
+// Returns: Twice the median pulse width or 0 if the window is empty
+unsigned int GetHistogramWindowMedian(const HistogramMedian* histogram_median, unsigned int window_index)
+{
+    if (window_index >= histogram_median->window_count)
+        return 0;
+
+    const HistogramWindow* window = &histogram_median->windows[window_index];
+
+    if (window->count == 0)
+        return 0;
+
+    // Zero-based ranks of the middle elements, which are equal if the window contains odd number of pulses
+    unsigned int lower_rank = (window->count - 1) / 2;
+    unsigned int upper_rank = window->count / 2;
+    unsigned int lower_width = 0;
+    unsigned int seen = 0;
+    bool lower_found = false;
+
+    for (unsigned int bin = 0; bin <= (unsigned int)(histogram_median->upper - histogram_median->lower); bin++)
+    {
+        seen += window->bins[bin];
+
+        if ((!lower_found) && (seen > lower_rank))
+        {
+            lower_width = histogram_median->lower + bin;
+            lower_found = true;
+        }
+
+        if (seen > upper_rank)
+            return lower_width + histogram_median->lower + bin;
+    }
+
+    return 2u * lower_width;
+}
+
+// Purpose: This function retrieves a quantile of the pulse widths of a window
+// The quantile is the pulse width of the nearest rank, found by walking the bins from the smallest pulse width
+// Params: A pointer to the histogram, the window index (0 for the primary window) and the quantile, (0, 1)
+// Returns: Twice the quantile pulse width or 0 if the window is empty
+unsigned int GetHistogramWindowQuantile(const HistogramMedian* histogram_median, unsigned int window_index, double p)
+{
+    if (window_index >= histogram_median->window_count)
+        return 0;
+
+    const HistogramWindow* window = &histogram_median->windows[window_index];
+
+    if (window->count == 0)
+        return 0;
+
+    // Zero-based nearest rank of the quantile, the smallest rank covering p of the pulses
+    double position = p * window->count;
+    unsigned int rank = (unsigned int)position;
+    unsigned int seen = 0;
+
+    if ((rank > 0) && ((double)rank == position))
+        rank--;
+
+    for (unsigned int bin = 0; bin <= (unsigned int)(histogram_median->upper - histogram_median->lower); bin++)
+    {
+        seen += window->bins[bin];
+
+        if (seen > rank)
+            return 2u * (histogram_median->lower + bin);
+    }
+
+    return 2u * histogram_median->upper;
+}
+
+// Purpose: This function prints contents of the primary window in the ascending order
+void PrintHistogramMedian(const HistogramMedian* histogram_median, FILE* fptr)
+{
+#if defined(PRINTF_MODE) && (LOG_MIN_LEVEL <= LOG_LEVEL_TRACE)
+    if (!LOG_ENABLED(LOG_LEVEL_TRACE))
+        return;
+
+    PrintStr("List:  ", fptr);
+
+    // Every bin holds a single pulse width, hence each width is converted once
+    unsigned int bin_count = histogram_median->upper - histogram_median->lower + 1;
+    unsigned short* widths = (unsigned short*)malloc(sizeof(unsigned short) * bin_count);
+    double* temps = (double*)malloc(sizeof(double) * bin_count);
+
+    if ((widths != NULL) && (temps != NULL))
+    {
+        for (unsigned int bin = 0; bin < bin_count; bin++)
+            widths[bin] = (unsigned short)(histogram_median->lower + bin);
+
+        ConvertPulseWidthsToTemps(widths, temps, bin_count);
+
+        for (unsigned int bin = 0; bin < bin_count; bin++)
+        {
+            for (unsigned int i = 0; i < histogram_median->windows[0].bins[bin]; i++)
+                PrintTemp(temps[bin], fptr);
+        }
+    }
+
+    free(widths);
+    free(temps);
+
+    PrintStr("\n", fptr);
+#endif
+}
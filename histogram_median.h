@@ -0,0 +1,54 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines histogram based sliding window median
+
+#pragma once
+
+#include "functions.h"
+#include "pulse_ring.h"
+
+#define MAX_HISTOGRAM_WINDOWS 4     // Primary window and up to three trend windows
+
+// Pulse widths are small integers within a known range, hence the window can be described by 
+// a counting histogram with one bin per pulse width. Adding or evicting a pulse only updates its bin, 
+// and the median is found by walking at most (upper - lower + 1) bins. A time-ordered ring buffer 
+// keeps the arrival order, so stale pulses are evicted from the oldest end. No memory is allocated 
+// after initialization, which keeps the per-pulse latency deterministic.
+// The companion index of every ring slot holds the histogram bin of the pulse.
+// Several windows of different lengths (e.g. 1, 10 and 60 seconds) can share one ring: every pulse 
+// is stored once and counted in the histogram of every window. Every window only holds the newest 
+// pulses of the ring, so its eviction cursor is simply its pulse count, and the ring drops a pulse 
+// once it has left the longest window. The ring capacity must cover the longest window; 
+// a pulse dropped by a full ring while still in a window is counted as truncated.
+
+// Window over the shared ring
+typedef struct
+{
+    unsigned int* bins;                 // Number of pulses per pulse width
+    unsigned int count;                 // Number of newest ring pulses within the window (eviction cursor)
+    uint64_t window_length;             // Microseconds
+} HistogramWindow;
+
+// Histogram based sliding window median
+typedef struct
+{
+    unsigned short lower;               // Smallest pulse width (milliseconds)
+    unsigned short upper;               // Largest pulse width (milliseconds)
+    PulseRing ring;                     // Time-ordered window store shared by all windows
+    HistogramWindow windows[MAX_HISTOGRAM_WINDOWS];
+    unsigned int window_count;          // Number of windows, the first one being the primary window
+    unsigned long truncated_count;      // Pulses dropped from a window by a full ring before they became stale
+} HistogramMedian;
+
+// Function declarations
+bool InitHistogramMedian(HistogramMedian* histogram_median, unsigned short lower, unsigned short upper, 
+    unsigned int capacity, uint64_t window_length);
+void FreeHistogramMedian(HistogramMedian* histogram_median);
+bool AddHistogramWindow(HistogramMedian* histogram_median, uint64_t window_length);
+unsigned int EvictStaleHistogramPulses(HistogramMedian* histogram_median, uint64_t timestamp, FILE* fptr);
+void AddHistogramPulse(HistogramMedian* histogram_median, Pulse pulse, FILE* fptr);
+unsigned int GetHistogramMedian(const HistogramMedian* histogram_median);
+unsigned int GetHistogramWindowMedian(const HistogramMedian* histogram_median, unsigned int window_index);
+unsigned int GetHistogramWindowQuantile(const HistogramMedian* histogram_median, unsigned int window_index, double p);
+void PrintHistogramMedian(const HistogramMedian* histogram_median, FILE* fptr);
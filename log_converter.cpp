@@ -0,0 +1,308 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module converts a binary log file to the human-readable text layout
+
+// Usage: LogConverter [-o text log file] <binary log file>...
+// If the text log file is not given, the text is written to the console.
+// The segments of a rolling log are converted as one log when given in order; their names sort 
+// in the order they were written, e.g. LogConverter log_*.bin. Every segment starts with its own header.
+
+// The sorted window dump ("List:") is not part of the binary log, so the converter rebuilds 
+// the window from the new pulse and stale pulse records using a counting histogram of pulse widths.
+// The window is only rendered if the log has been written at the trace log level.
+// Pulses a full pulse store dropped to make room for new ones are logged as stale pulses as well, 
+// so the rebuilt window matches the window of the writer, and the rendered stale pulses include them.
+// Every channel has a window of its own, rebuilt from the records carrying its identifier, 
+// and every rendered line starts with the channel identifier, e.g. "[2] Median:".
+
+#include "functions.h"
+#include "binary_log.h"
+#include "pulse_kernels.h"
+
+#define WIDTH_RANGE 65536
+#define CHANNEL_RANGE 65536
+
+// Rebuilt window of a channel
+typedef struct
+{
+    unsigned int* bins;             // Number of pulses of every pulse width in the window
+    unsigned short* stale_widths;   // Pulses evicted since the last median record
+    unsigned int stale_count;
+    unsigned int stale_capacity;
+    unsigned int window_count;      // Number of pulses in the rebuilt window
+    unsigned int min_width;         // Smallest pulse width seen
+    unsigned int max_width;         // Largest pulse width seen
+    bool alert_flag;
+    bool batch_flag;                // Pulses of the current batch precede its median record
+    uint32_t alert_duration;
+} ChannelWindow;
+
+// Purpose: This function renders a temperature value
+static void RenderTemp(FILE* out, double temp)
+{
+    fprintf(out, " %4.1f", temp);
+}
+
+// Purpose: This function retrieves the window of a channel, which is allocated when its first record is read
+// Params: The windows of all channels and the channel identifier
+// Returns: A pointer to the window, or NULL if it could not be allocated
+static ChannelWindow* GetChannelWindow(ChannelWindow** windows, uint16_t channel)
+{
+    if (windows[channel] == NULL)
+    {
+        ChannelWindow* window = (ChannelWindow*)calloc(1, sizeof(ChannelWindow));
+
+        if (window == NULL)
+            return NULL;
+
+        window->bins = (unsigned int*)calloc(WIDTH_RANGE, sizeof(unsigned int));
+
+        if (window->bins == NULL)
+        {
+            free(window);
+            return NULL;
+        }
+
+        window->min_width = WIDTH_RANGE - 1;
+        windows[channel] = window;
+    }
+
+    return windows[channel];
+}
+
+// Purpose: This function frees the windows of all channels
+static void FreeChannelWindows(ChannelWindow** windows)
+{
+    for (unsigned int channel = 0; channel < CHANNEL_RANGE; channel++)
+    {
+        if (windows[channel] != NULL)
+        {
+            free(windows[channel]->bins);
+            free(windows[channel]->stale_widths);
+            free(windows[channel]);
+        }
+    }
+
+    free(windows);
+}
+
+// Purpose: This function renders a record into the text layout
+// Params: A record, the window of its channel, the temperature of every pulse width, whether the log 
+// holds trace and median records and the output file
+// Returns: True if the record has been converted; false if the window storage could not be allocated
+static bool ConvertRecord(const BinaryLogRecord* record, ChannelWindow* window, const double* temps, 
+    bool trace_flag, bool median_flag, FILE* out)
+{
+    switch (record->type)
+    {
+    case RECORD_NEW_PULSE:
+        fprintf(out, "[%u] New:   ", record->channel);
+        RenderTemp(out, temps[record->width]);
+        fprintf(out, "\n");
+        break;
+
+    case RECORD_STALE_PULSE:
+        if (window->stale_count == window->stale_capacity)
+        {
+            window->stale_capacity = (window->stale_capacity > 0) ? (window->stale_capacity * 2) : 64;
+            window->stale_widths = (unsigned short*)realloc(window->stale_widths, 
+                sizeof(unsigned short) * window->stale_capacity);
+
+            if (window->stale_widths == NULL)
+                return false;
+        }
+
+        window->stale_widths[window->stale_count++] = record->width;
+
+        if (window->bins[record->width] > 0)
+        {
+            window->bins[record->width]--;
+            window->window_count--;
+        }
+        break;
+
+    case RECORD_ALERT:
+        // Without median records the alert is rendered on its own
+        if (!median_flag)
+        {
+            fprintf(out, "[%u] Alert duration %u\n", record->channel, record->value);
+            break;
+        }
+
+        window->alert_flag = true;
+        window->alert_duration = record->value;
+        break;
+
+    case RECORD_BATCH_PULSE:
+    case RECORD_MEDIAN:
+        // Eviction is reported whenever the window was not empty before the new pulse was added, 
+        // once per batch of pulses sharing a median record
+        if (trace_flag && (!window->batch_flag) && ((window->window_count + window->stale_count) > 0))
+        {
+            fprintf(out, "[%u] Stale: ", record->channel);
+
+            for (unsigned int i = 0; i < window->stale_count; i++)
+                RenderTemp(out, temps[window->stale_widths[i]]);
+
+            fprintf(out, "\n");
+        }
+
+        window->stale_count = 0;
+
+        window->bins[record->width]++;
+        window->window_count++;
+
+        if (record->width < window->min_width)
+            window->min_width = record->width;
+
+        if (record->width > window->max_width)
+            window->max_width = record->width;
+
+        if (record->type == RECORD_BATCH_PULSE)
+        {
+            window->batch_flag = true;
+            break;
+        }
+
+        window->batch_flag = false;
+
+        if (trace_flag)
+        {
+            fprintf(out, "[%u] List:  ", record->channel);
+
+            for (unsigned int width = window->min_width; width <= window->max_width; width++)
+            {
+                for (unsigned int i = 0; i < window->bins[width]; i++)
+                    RenderTemp(out, temps[width]);
+            }
+
+            fprintf(out, "\n");
+        }
+
+        fprintf(out, "[%u] Median:", record->channel);
+        RenderTemp(out, ConvertDoubledPulseWidthToTemp(record->value));
+
+        if (window->alert_flag)
+            fprintf(out, " - Alert duration %u\n", window->alert_duration);
+        else
+            fprintf(out, "\n");
+
+        window->alert_flag = false;
+        break;
+
+    case RECORD_WARNING_ON:
+        fprintf(out, "[%u] \tWarning On\n", record->channel);
+        break;
+
+    case RECORD_WARNING_OFF:
+        fprintf(out, "[%u] \tWarning Off\n", record->channel);
+        break;
+
+    case RECORD_IDLE:
+        fprintf(out, "[%u] \tIdle\n", record->channel);
+        break;
+
+    case RECORD_PRE_ALARM:
+        fprintf(out, "[%u] \tPre-alarm\n", record->channel);
+        break;
+
+    case RECORD_LATCHED:
+        fprintf(out, "[%u] \tLatched\n", record->channel);
+        break;
+
+    case RECORD_ACKNOWLEDGED:
+        fprintf(out, "[%u] \tAcknowledged\n", record->channel);
+        break;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* out_name = NULL;
+    int first_arg = 1;
+
+    if ((argc > 2) && (strcmp(argv[1], "-o") == 0))
+    {
+        out_name = argv[2];
+        first_arg = 3;
+    }
+
+    if (first_arg >= argc)
+    {
+        fprintf(stderr, "Usage: %s [-o text log file] <binary log file>...\n", argv[0]);
+        return 1;
+    }
+
+    FILE* out = (out_name != NULL) ? fopen(out_name, "w") : stdout;
+
+    if (out == NULL)
+    {
+        fprintf(stderr, "Cannot create %s\n", out_name);
+        return 1;
+    }
+
+    ChannelWindow** windows = (ChannelWindow**)calloc(CHANNEL_RANGE, sizeof(ChannelWindow*));
+    unsigned short* widths = (unsigned short*)malloc(sizeof(unsigned short) * WIDTH_RANGE);
+    double* temps = (double*)malloc(sizeof(double) * WIDTH_RANGE);    // Temperature of every pulse width
+    int status = 0;
+
+    if ((windows == NULL) || (widths == NULL) || (temps == NULL))
+        return 1;
+
+    // Every pulse width is converted once up front, so rendering the pulses is a table lookup
+    for (unsigned int width = 0; width < WIDTH_RANGE; width++)
+        widths[width] = (unsigned short)width;
+
+    ConvertPulseWidthsToTemps(widths, temps, WIDTH_RANGE);
+
+    // The windows of the channels carry over from one segment to the next
+    for (int arg = first_arg; (arg < argc) && (status == 0); arg++)
+    {
+        FILE* in = fopen(argv[arg], "rb");
+        BinaryLogHeader header;
+        BinaryLogRecord record;
+
+        if ((in == NULL) || (!ReadBinaryLogHeader(in, &header)))
+        {
+            fprintf(stderr, "%s is not a binary log file\n", argv[arg]);
+
+            if (in != NULL)
+                fclose(in);
+
+            status = 1;
+            break;
+        }
+
+        bool trace_flag = (header.log_level <= LOG_LEVEL_TRACE);
+        bool median_flag = (header.log_level <= LOG_LEVEL_MEDIAN);
+
+        while (ReadBinaryLogRecord(in, &record))
+        {
+            ChannelWindow* window = GetChannelWindow(windows, record.channel);
+
+            if ((window == NULL) || (!ConvertRecord(&record, window, temps, trace_flag, median_flag, out)))
+            {
+                status = 1;
+                break;
+            }
+        }
+
+        // A log segment that was not closed cleanly ends with its unwritten, zero-filled tail
+        if ((status == 0) && (!feof(in)))
+            fprintf(stderr, "%s: The records end before the end of the file\n", argv[arg]);
+
+        fclose(in);
+    }
+
+    FreeChannelWindows(windows);
+    free(widths);
+    free(temps);
+
+    if (out != stdout)
+        fclose(out);
+
+    return status;
+}
@@ -0,0 +1,324 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements asynchronous batched logger
+
+#include "logger.h"
+#include "rolling_log.h"
+#include "platform.h"
+
+// Logger state shared by the producing threads and the logging thread
+static struct
+{
+    FILE* fptr;
+    LOG_SINK sink;
+    struct Thread* thread;
+    struct Event* exit_event;           // Manual-reset event signalled when the logging thread is to exit
+    std::atomic<bool> running;
+    std::atomic<unsigned int> buffer_count;
+    std::atomic<LogBuffer*> buffers[LOG_MAX_THREADS];
+    std::atomic<unsigned long> dropped_bytes;
+    std::atomic<unsigned int> muted_threads;    // Threads that could not get a buffer
+    char batch[LOG_BATCH_SIZE];
+    unsigned int batch_size;
+} logger;
+
+// Buffer of the calling thread, registered on first use
+static thread_local LogBuffer* thread_buffer = NULL;
+
+// Set once the calling thread could not get a buffer, so it is counted once and registers no further slots
+static thread_local bool thread_muted_flag = false;
+
+// Purpose: This utility function writes the batch to the console and the log file
+static void FlushBatch()
+{
+    if (logger.batch_size > 0)
+    {
+        if (logger.sink == LOG_SINK_TEXT)
+            fwrite(logger.batch, 1, logger.batch_size, stdout);
+
+        WriteLogFile(logger.batch, logger.batch_size, logger.fptr);
+
+        logger.batch_size = 0;
+    }
+}
+
+// Purpose: This utility function moves published bytes of all thread buffers into the batch
+static void DrainBuffers()
+{
+    unsigned int count = logger.buffer_count.load(std::memory_order_acquire);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        LogBuffer* buffer = logger.buffers[i].load(std::memory_order_acquire);
+
+        if (buffer == NULL)
+            continue;
+
+        unsigned int tail = buffer->tail.load(std::memory_order_relaxed);
+        unsigned int head = buffer->head.load(std::memory_order_acquire);
+
+        while (tail != head)
+        {
+            if (logger.batch_size == LOG_BATCH_SIZE)
+                FlushBatch();
+
+            // Copy the contiguous part of the published bytes that fits into the batch
+            unsigned int offset = tail & (LOG_BUFFER_SIZE - 1);
+            unsigned int len = head - tail;
+
+            if (len > (LOG_BUFFER_SIZE - offset))
+                len = LOG_BUFFER_SIZE - offset;
+
+            if (len > (LOG_BATCH_SIZE - logger.batch_size))
+                len = LOG_BATCH_SIZE - logger.batch_size;
+
+            memcpy(&logger.batch[logger.batch_size], &buffer->data[offset], len);
+            logger.batch_size += len;
+            tail += len;
+        }
+
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+}
+
+// Purpose: This function drains the thread buffers in a dedicated thread of execution
+static void RunLogger(void* ptr)
+{
+    (void)ptr;
+
+    while (true)
+    {
+        bool exit_flag = WaitEvent(logger.exit_event, LOG_FLUSH_INTERVAL);
+
+        DrainBuffers();
+        FlushBatch();
+
+        if (exit_flag)
+            return;
+    }
+}
+
+// Purpose: This utility function retrieves the buffer of the calling thread, registering it on first use
+// Returns: The thread buffer or NULL if no more buffers can be registered
+static LogBuffer* GetThreadBuffer()
+{
+    if ((thread_buffer == NULL) && (!thread_muted_flag))
+    {
+        unsigned int index = logger.buffer_count.load(std::memory_order_relaxed);
+
+        // Reserve a slot in the buffer table
+        do
+        {
+            if (index >= LOG_MAX_THREADS)
+            {
+                thread_muted_flag = true;
+                logger.muted_threads.fetch_add(1, std::memory_order_relaxed);
+                return NULL;
+            }
+        } while (!logger.buffer_count.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel));
+
+        LogBuffer* buffer = (LogBuffer*)malloc(sizeof(LogBuffer));
+
+        if (buffer != NULL)
+        {
+            buffer->pending = 0;
+            buffer->dropping_flag = false;
+            buffer->head.store(0, std::memory_order_relaxed);
+            buffer->tail.store(0, std::memory_order_relaxed);
+        }
+        else
+        {
+            thread_muted_flag = true;
+            logger.muted_threads.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        logger.buffers[index].store(buffer, std::memory_order_release);
+        thread_buffer = buffer;
+    }
+
+    return thread_buffer;
+}
+
+// Purpose: This function starts the logging thread
+// Params: A log file pointer and the log sink, text output is also written to the console
+// Returns: True if the logging thread has been started; false otherwise
+bool StartLogger(FILE* fptr, LOG_SINK sink)
+{
+    logger.fptr = fptr;
+    logger.sink = sink;
+    logger.batch_size = 0;
+    logger.dropped_bytes.store(0, std::memory_order_relaxed);
+    logger.muted_threads.store(0, std::memory_order_relaxed);
+    logger.exit_event = NewEvent(true);
+    logger.thread = (logger.exit_event != NULL) ? StartThread(RunLogger, NULL, NULL) : NULL;
+
+    if (logger.thread == NULL)
+    {
+        FreeEvent(logger.exit_event);
+        logger.exit_event = NULL;
+    }
+
+    logger.running.store(logger.thread != NULL, std::memory_order_release);
+
+    return (logger.thread != NULL);
+}
+
+// Purpose: This function stops the logging thread, flushes all buffered output and releases the thread buffers
+// It must be called after all other threads that log have finished
+void StopLogger()
+{
+    if (!logger.running.load(std::memory_order_acquire))
+        return;
+
+    SignalEvent(logger.exit_event);
+    JoinThread(logger.thread);
+    FreeEvent(logger.exit_event);
+
+    logger.thread = NULL;
+    logger.exit_event = NULL;
+
+    logger.running.store(false, std::memory_order_release);
+
+    // Publish incomplete lines left behind by the finished threads
+    unsigned int count = logger.buffer_count.load(std::memory_order_acquire);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        LogBuffer* buffer = logger.buffers[i].load(std::memory_order_acquire);
+
+        if (buffer != NULL)
+            buffer->head.store(buffer->pending, std::memory_order_release);
+    }
+
+    DrainBuffers();
+    FlushBatch();
+
+    // Release the thread buffers, which hold no more output
+    for (unsigned int i = 0; i < count; i++)
+    {
+        free(logger.buffers[i].load(std::memory_order_relaxed));
+        logger.buffers[i].store(NULL, std::memory_order_relaxed);
+    }
+
+    logger.buffer_count.store(0, std::memory_order_release);
+    thread_buffer = NULL;
+    thread_muted_flag = false;
+
+    FlushLogFile(logger.fptr);
+
+    fflush(stdout);
+}
+
+// Purpose: This function checks whether the logging thread is running
+bool IsLoggerRunning()
+{
+    return logger.running.load(std::memory_order_acquire);
+}
+
+// Purpose: This function selects the log sink
+// The sink must not be changed while the logging thread is running
+void SetLogSink(LOG_SINK sink)
+{
+    logger.sink = sink;
+}
+
+// Purpose: This function retrieves the selected log sink
+LOG_SINK GetLogSink()
+{
+    return logger.sink;
+}
+
+// Purpose: This utility function appends bytes to the buffer of the calling thread
+// Text is published by complete lines only; a line that does not fit is dropped as a whole
+// Params: Bytes to append, their number and whether to publish them as a whole rather than by complete lines
+static void AppendToBuffer(const char* str, unsigned int len, bool publish_all)
+{
+    LogBuffer* buffer = GetThreadBuffer();
+
+    if (buffer == NULL)
+    {
+        logger.dropped_bytes.fetch_add(len, std::memory_order_relaxed);
+        return;
+    }
+
+    while (len > 0)
+    {
+        // Skip the rest of a dropped line up to its end
+        if (buffer->dropping_flag && (!publish_all))
+        {
+            const char* end = (const char*)memchr(str, '\n', len);
+            unsigned int skipped = (end != NULL) ? (unsigned int)(end - str + 1) : len;
+
+            logger.dropped_bytes.fetch_add(skipped, std::memory_order_relaxed);
+            buffer->dropping_flag = (end == NULL);
+            str += skipped;
+            len -= skipped;
+            continue;
+        }
+
+        unsigned int tail = buffer->tail.load(std::memory_order_acquire);
+        unsigned int head = buffer->head.load(std::memory_order_relaxed);
+
+        // Drop the record if it does not fit into the free space of the buffer
+        if ((buffer->pending - tail + len) > LOG_BUFFER_SIZE)
+        {
+            if (publish_all)
+            {
+                logger.dropped_bytes.fetch_add(len, std::memory_order_relaxed);
+                return;
+            }
+
+            // Take back the unpublished start of the line and drop the rest of it
+            logger.dropped_bytes.fetch_add(buffer->pending - head, std::memory_order_relaxed);
+            buffer->pending = head;
+            buffer->dropping_flag = true;
+            continue;
+        }
+
+        unsigned int line_end = head;
+
+        for (unsigned int i = 0; i < len; i++)
+        {
+            buffer->data[buffer->pending & (LOG_BUFFER_SIZE - 1)] = str[i];
+            buffer->pending++;
+
+            if (str[i] == '\n')
+                line_end = buffer->pending;
+        }
+
+        if (publish_all)
+            line_end = buffer->pending;
+
+        buffer->head.store(line_end, std::memory_order_release);
+        return;
+    }
+}
+
+// Purpose: This function appends a text record to the buffer of the calling thread
+// The buffered bytes are published to the logging thread once a line is complete
+// Params: A record and its length (bytes)
+void LogWrite(const char* str, unsigned int len)
+{
+    AppendToBuffer(str, len, false);
+}
+
+// Purpose: This function appends a binary record to the buffer of the calling thread
+// The record is published to the logging thread at once
+// Params: A record and its length (bytes)
+void LogWriteRecord(const void* record, unsigned int len)
+{
+    AppendToBuffer((const char*)record, len, true);
+}
+
+// Purpose: This function retrieves the number of bytes dropped because a thread buffer was full or missing
+unsigned long GetLoggerDroppedBytes()
+{
+    return logger.dropped_bytes.load(std::memory_order_relaxed);
+}
+
+// Purpose: This function retrieves the number of threads whose output is dropped because they got no buffer
+unsigned int GetLoggerMutedThreads()
+{
+    return logger.muted_threads.load(std::memory_order_relaxed);
+}
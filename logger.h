@@ -0,0 +1,53 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines asynchronous batched logger
+
+#pragma once
+
+#include <atomic>
+
+#include "functions.h"
+
+#define LOG_BUFFER_SIZE     65536   // Bytes per thread buffer (power of two)
+#define LOG_BATCH_SIZE      262144  // Bytes written to the console and the log file at once
+#define LOG_MAX_THREADS     64      // Maximum number of threads that may log
+#define LOG_FLUSH_INTERVAL  20      // Milliseconds
+
+// The logger moves console and file output off the threads that produce it.
+// Every thread formats its records into its own lock-free single-producer/single-consumer byte buffer, 
+// which is registered with the logger on first use. A background logging thread drains all buffers 
+// into a large batch and writes it to the console and the log file in one go.
+// A thread publishes its buffered bytes only when a line is complete, so lines of different 
+// threads never interleave. If a thread buffer is full, the whole line the record belongs to is dropped 
+// and counted instead of blocking the producer: its unpublished start is taken back and the rest of it 
+// is skipped up to its end, so only complete lines are ever written. Binary records are published 
+// as soon as they are written. Threads beyond LOG_MAX_THREADS get no buffer; their records are dropped 
+// and the threads are counted as muted.
+
+// Log sinks
+typedef enum {
+    LOG_SINK_TEXT,          // Human-readable text written to the console and the log file
+    LOG_SINK_BINARY         // Fixed-size binary records written to the log file only (see binary_log.h)
+} LOG_SINK;
+
+// Per-thread log buffer
+typedef struct
+{
+    char data[LOG_BUFFER_SIZE];
+    unsigned int pending;                   // Next byte to write, not yet published (owned by the producer)
+    bool dropping_flag;                     // The rest of the current line is dropped (owned by the producer)
+    std::atomic<unsigned int> head;         // Published bytes end here (written by the producer)
+    std::atomic<unsigned int> tail;         // Consumed bytes end here (written by the logging thread)
+} LogBuffer;
+
+// Function declarations
+bool StartLogger(FILE* fptr, LOG_SINK sink);
+void StopLogger();
+bool IsLoggerRunning();
+void SetLogSink(LOG_SINK sink);
+LOG_SINK GetLogSink();
+void LogWrite(const char* str, unsigned int len);
+void LogWriteRecord(const void* record, unsigned int len);
+unsigned long GetLoggerDroppedBytes();
+unsigned int GetLoggerMutedThreads();
@@ -4,255 +4,669 @@
 // DESCRIPTION: This module simulates electrical thermostat measuring and reporting superficial system
 
 // Algorithm:
-// Create three threads
-// First thread generates electrical pulses at a variable rate within the predefined range of [5, 80] (milliseconds)
-// Second thread generates warnings in the intermittent (on/off) fashion at a predefined frequency of 5 milliseconds
-// Main thread processes electrical pulses created by the first thread and commands the second thread to 
-// generate warnings when temperature exceeds the predefined limit of 70 degrees Celsius for longer than 1 second
+// Create a pulse thread, a warning thread and a pool of worker threads
+// Pulse thread generates electrical pulses of every channel at a variable rate within the predefined range of [5, 80] (milliseconds)
+// Warning thread generates warnings of every channel in the intermittent (on/off) fashion at a predefined frequency of 5 milliseconds
+// Worker threads process electrical pulses created by the pulse thread and command the warning thread to 
+// generate warnings when temperature of a channel exceeds the predefined limit of 70 degrees Celsius for longer than 1 second
+// Main thread configures the channels and stops all threads once the measurement duration is over, or in the daemon mode 
+// once a shutdown is requested; meanwhile it reloads the alert thresholds whenever the settings file changes 
+// and acknowledges the alarms of all channels on the acknowledge signal (SIGUSR1, Ctrl+Break on Windows)
+// Usage: ElectricalThermostat [--config <settings file>] [--replay <log file>] [--daemon] [--<setting> <value>]... (see settings.h)
+// In the replay mode the pulses recorded in a text or binary log file are processed instead in virtual time (see replay.h)
 
 // Definition of a median:
 // The median is the middle value in a list ordered from smallest to largest.
 // If the elements of the list are arranged in order, then, the middle value which divides 
 // the items into two parts with equal number of items on either side is called the median.
 
+#include <signal.h>
+
 #include "functions.h"
 #include "state_machine.h"
-
-// Generated pulse signal is shared by two threads
-static Pulse pulse = { false, 0, 0.0, 0 };
-
-// Warning flag is shared by two threads
-static bool warnings_on_flag = false;
-
-CRITICAL_SECTION pulse_cs;
-CRITICAL_SECTION print_cs;
-CRITICAL_SECTION warning_cs;
-
-DWORD WINAPI GeneratePulses(LPVOID ptr);
-DWORD WINAPI GenerateWarnings(LPVOID ptr);
+#include "channel_pool.h"
+#include "logger.h"
+#include "binary_log.h"
+#include "rolling_log.h"
+#include "pulse_kernels.h"
+#include "periodic_timer.h"
+#include "replay.h"
+#include "pulse_generator.h"
+#include "settings.h"
+#include "platform.h"
+
+// Channels are shared by all threads
+static struct ChannelPool channel_pool;
+
+// Paces the warnings of every channel
+static PeriodicTimer warning_timer;
+
+// Simulated sensors of every channel
+static PulseGeneratorConfig generator_config;
+static uint64_t generator_seed;
+
+// Runtime settings and the alert thresholds published to every channel
+static Settings settings;
+static ThresholdState threshold_state;
+
+// Set by the signal handler to request a graceful shutdown
+static std::atomic<bool> shutdown_flag(false);
+
+// The operator acknowledges the alarms of all channels by a signal, Ctrl+Break on Windows
+#if defined(_WIN32) || defined(_WIN64)
+#define ACKNOWLEDGE_SIGNAL SIGBREAK
+#else
+#define ACKNOWLEDGE_SIGNAL SIGUSR1
+#endif
+
+// Set by the signal handler to request the acknowledgement of the alarms
+static std::atomic<bool> acknowledge_flag(false);
+
+static void GeneratePulses(void* ptr);
+static void GenerateWarnings(void* ptr);
+static void RunSimulation(FILE* fptr);
+static void RequestShutdown(int signal_number);
+static void RequestAcknowledge(int signal_number);
+static void GetAlertThresholds(AlertThresholds* thresholds);
 
 // Events to command threads to exit
-HANDLE pulses_event_handle = CreateEvent(nullptr, true, false, nullptr);
-HANDLE warnings_event_handle = CreateEvent(nullptr, true, false, nullptr);
+static struct Event* pulses_event = NewEvent(true);
+static struct Event* warnings_event = NewEvent(true);
 
-int main(void)
+int main(int argc, char* argv[])
 {
     // ----- Configuration parameters -----
-    const unsigned long warning_threshold = 1000;               // Milliseconds
-    const unsigned short polling_time_interval = 1;             // Milliseconds
-    const unsigned long measurement_duration_limit = 10000;     // Milliseconds (10 seconds)
-    const unsigned short pulse_width_warning_threshold = 58;    // Milliseconds (pulse width 58 is equivalent to 70 degrees Celsius)
+    const SCHEDULING_MODE scheduling_mode = SCHEDULING_MODE_WORK_STEALING;  // Channel scheduling mode
+    const unsigned long trend_window_lengths[] = { 10000, 60000, 600000 };  // Milliseconds
+    const TREND_BACKEND trend_window_backends[] = { TREND_BACKEND_EXACT, TREND_BACKEND_QUANTILE, TREND_BACKEND_QUANTILE };
 
-    // ----- Runtime parameters -----
-    DWORD pulses_thread_id, warnings_thread_id;
-    HANDLE pulses_thread_handle, warnings_thread_handle;
+    // The other parameters are loaded from the settings file and the command line
+    InitSettings(&settings);
+
+    if (!ParseSettings(&settings, argc, argv))
+    {
+        PrintSettingsUsage(argv[0]);
+        return 1;
+    }
+
+    const MEDIAN_MODE median_mode = settings.median_mode;
+    const LOG_SINK log_sink = settings.log_sink;
+    const unsigned int worker_count = GetDefaultWorkerCount(settings.channel_count);
 
-    uint64_t warning_alert_timestamp = GetSystemTime();
-    bool warning_alert_flag = false;            // Stores warning alert           
-    double pulse_width_median = 0;              // Stores calculated pulse width median
+    // ----- Runtime parameters -----
     FILE* fptr = NULL;                          // File pointer
-    struct Node* head_ptr = NULL;               // Start with an empty list
-    char* log_file_name = (char*)malloc(sizeof(char) * 30);
-    Pulse new_pulse = { false, 0, 0.0, 0 };
-    
+    const char* replay_file_name = settings.replay_file_name;
+    ReplaySource replay_source;
+    AlertThresholds thresholds;
+    char log_file_name[ROLLING_LOG_NAME_SIZE];
+    char log_timestamp[LOG_TIMESTAMP_SIZE];
+    RollingLogConfig log_config;
+    BinaryLogHeader log_header;
+    ChannelConfig channel_config;
+
+    GetAlertThresholds(&thresholds);
+    InitThresholdState(&threshold_state, &thresholds);
+
+    channel_config.median_mode = median_mode;
+    channel_config.pulse_width_lower_limit = pulse_width_lower_limit;
+    channel_config.pulse_width_upper_limit = pulse_width_upper_limit;
+    channel_config.window_capacity = settings.window_capacity;
+    channel_config.window_length = ONE_SEC_IN_USEC;
+    channel_config.pulse_queue_capacity = settings.pulse_queue_capacity;
+    channel_config.threshold_state = &threshold_state;
+    channel_config.batch_ingest_flag = settings.batch_ingest;
+
+    channel_config.trend_window_count = 0;
+    uint64_t exact_window_length = channel_config.window_length;    // Longest window storing its pulses (microseconds)
+
+    // Exact trend windows share the pulse store of the histogram window, so the other modes only get the approximate ones; 
+    // the skipped exact trend windows are reported at startup and in the final report
+    for (unsigned int i = 0; i < sizeof(trend_window_lengths) / sizeof(trend_window_lengths[0]); i++)
+    {
+        uint64_t trend_window_length = (uint64_t)trend_window_lengths[i] * ONE_MSEC_IN_USEC;
+
+        if ((trend_window_backends[i] == TREND_BACKEND_EXACT) && (median_mode != MEDIAN_MODE_HISTOGRAM))
+        {
+            fprintf(stderr, "Skipped the exact %lu ms trend window, which needs the histogram median mode\n", 
+                trend_window_lengths[i]);
+            continue;
+        }
+
+        if (channel_config.trend_window_count < MAX_TREND_WINDOWS)
+        {
+            channel_config.trend_window_lengths[channel_config.trend_window_count] = trend_window_length;
+            channel_config.trend_window_backends[channel_config.trend_window_count++] = trend_window_backends[i];
+
+            if ((trend_window_backends[i] == TREND_BACKEND_EXACT) && (exact_window_length < trend_window_length))
+                exact_window_length = trend_window_length;
+        }
+    }
 
-    // Create log file with a unique timestamp
-    if (log_file_name != NULL)
+    // The pulse store must hold the longest exact window at the highest pulse rate of the generator, 
+    // one pulse every shortest pulse width plus the inter-arrival time
+    uint64_t pulse_period = (uint64_t)(pulse_width_lower_limit + settings.pulse_interval) * ONE_MSEC_IN_USEC;
+    uint64_t required_capacity = exact_window_length / pulse_period + 1;
+
+    if (required_capacity > channel_config.window_capacity)
+        channel_config.window_capacity = (unsigned int)required_capacity;
+
+    if ((replay_file_name != NULL) && !OpenReplaySource(&replay_source, replay_file_name, settings.pulse_interval))
+    {
+        fprintf(stderr, "Cannot open %s\n", replay_file_name);
+        return 1;
+    }
+
+    SetLogSink(log_sink);
+    SetLogLevel(settings.log_level);
+
+    // Create the rolling log, whose binary segments each start with the header, 
+    // or a single log file with a unique timestamp
+    if (settings.log_segment_size > 0)
+    {
+        InitBinaryLogHeader(&log_header);
+
+        log_config.prefix = "log_";
+        log_config.extension = (log_sink == LOG_SINK_BINARY) ? ".bin" : ".txt";
+        log_config.segment_size = settings.log_segment_size;
+        log_config.segment_duration = (uint64_t)settings.log_segment_duration * ONE_MSEC_IN_USEC;
+        log_config.disk_limit = settings.log_disk_limit;
+        log_config.record_size = (log_sink == LOG_SINK_BINARY) ? sizeof(BinaryLogRecord) : 1;
+        log_config.header = (log_sink == LOG_SINK_BINARY) ? &log_header : NULL;
+        log_config.header_size = (log_sink == LOG_SINK_BINARY) ? sizeof(log_header) : 0;
+
+        if (OpenRollingLog(&log_config))
+            fptr = ROLLING_LOG_FILE;
+    }
+    else
+    {
+        CreateLogFileTimeStamp(log_timestamp, sizeof(log_timestamp));
+        snprintf(log_file_name, sizeof(log_file_name), "log_%s%s", 
+            log_timestamp, (log_sink == LOG_SINK_BINARY) ? ".bin" : ".txt");
+        fptr = fopen(log_file_name, (log_sink == LOG_SINK_BINARY) ? "wb" : "w");
+
+        if (log_sink == LOG_SINK_BINARY)
+            WriteBinaryLogHeader(fptr);
+    }
+
+    // The normal and step distributions hover around 63 degrees Celsius, the step crosses the warning temperature limit 
+    // for about 50 pulses; the ramp sweeps the whole range
+    generator_config.distribution = settings.pulse_distribution;
+    generator_config.lower = pulse_width_lower_limit;
+    generator_config.upper = pulse_width_upper_limit;
+    generator_config.setpoint = 52.0;
+    generator_config.spread = 2.0;
+    generator_config.step = 12.0;
+    generator_config.period = 50;
+
+    // Use current system time as seed for the simulated sensors unless a seed has been given
+    generator_seed = (settings.pulse_seed != 0) ? settings.pulse_seed : GetSystemTime();
+
+    // The replayed pulses are timed by the virtual clock from the start of the recording
+    if (replay_file_name != NULL)
+        SetVirtualTime(replay_source.start_time);
+
+    if (!InitChannelPool(&channel_pool, settings.channel_count, worker_count, scheduling_mode, &channel_config, fptr))
     {
-        memset(log_file_name, 0, sizeof(char) * 30);
-        strcpy(log_file_name, "log_");
-        strcat(log_file_name, CreateLogFileTimeStamp());
-        strcat(log_file_name, ".txt");
-        fptr = fopen(log_file_name, "w");
-    } 
-
-    // Use current system time as seed for random number generator 
-    srand((unsigned int)GetSystemTime());
-
-    InitializeCriticalSection(&pulse_cs);
-    InitializeCriticalSection(&warning_cs);
-    InitializeCriticalSection(&print_cs);
-
-    // Parameters: default security attributes, default stack size, thread function, 
-    // parameter to thread function, default creation flags
-    // Return: thread identifier
-    pulses_thread_handle = CreateThread(NULL, 0, GeneratePulses, fptr, 0, &pulses_thread_id);
-    warnings_thread_handle = CreateThread(NULL, 0, GenerateWarnings, fptr, 0, &warnings_thread_id);
-
-    if ((pulses_thread_handle != NULL) && (warnings_thread_handle != NULL))
+        CloseLogFile(fptr);
+        return 1;
+    }
+
+    if (!InitPeriodicTimer(&warning_timer, (uint64_t)settings.warning_period * ONE_MSEC_IN_USEC))
+    {
+        FreeChannelPool(&channel_pool);
+        CloseLogFile(fptr);
+        return 1;
+    }
+
+    if (replay_file_name != NULL)
     {
-        uint64_t start_time = GetSystemTime();
+        // The replayed pulses are processed synchronously without the logging thread, 
+        // so no output is dropped and every replay of a recording produces the same output
+        ReplayPulses(&channel_pool, &replay_source, (uint64_t)settings.warning_period * ONE_MSEC_IN_USEC);
 
-        while (GetSystemTime() < (start_time + measurement_duration_limit))
+        if (replay_source.skipped_count > 0)
+            fprintf(stderr, "Skipped %lu pulses of channels beyond the channel count %u\n", 
+                replay_source.skipped_count, channel_pool.channel_count);
+
+        CloseReplaySource(&replay_source);
+        PrintChannelPoolStats(&channel_pool);
+    }
+    else
+    {
+        RunSimulation(fptr);
+    }
+
+    uint64_t wakeup_latency_total = 0;          // Sum of pulse arrival to processing latencies (microseconds)
+    uint64_t wakeup_latency_max = 0;            // Largest pulse arrival to processing latency (microseconds)
+    uint64_t alert_latency_total = 0;           // Sum of alert publication to warning thread latencies (microseconds)
+    uint64_t alert_latency_max = 0;             // Largest alert publication to warning thread latency (microseconds)
+    unsigned long alert_change_count = 0;       // Number of alert changes observed by the warning thread
+    unsigned long lost_change_count = 0;        // Number of alert changes overwritten before the warning thread observed them
+    unsigned long processed_count = 0;          // Number of processed pulses
+    unsigned long dropped_count = 0;            // Number of dropped pulses
+    unsigned long above_threshold_count = 0;    // Number of pulses wider than the warning threshold
+    unsigned int high_water_mark = 0;           // Largest node pool high-water mark
+    unsigned long truncated_count = 0;          // Number of pulses a full window could not keep until they became stale
+
+    for (unsigned int id = 0; id < channel_pool.channel_count; id++)
+    {
+        Channel* channel = &channel_pool.channels[id];
+
+        wakeup_latency_total += channel->wakeup_latency_total;
+        processed_count += channel->processed_count;
+        dropped_count += GetDroppedPulses(&channel->queue);
+        above_threshold_count += channel->above_threshold_count;
+        alert_latency_total += channel->alert_latency_total;
+        alert_change_count += channel->alert_change_count;
+        lost_change_count += channel->lost_change_count;
+        truncated_count += GetWindowTruncatedCount(&channel->window);
+
+        if (channel->wakeup_latency_max > wakeup_latency_max)
+            wakeup_latency_max = channel->wakeup_latency_max;
+
+        if (channel->alert_latency_max > alert_latency_max)
+            alert_latency_max = channel->alert_latency_max;
+
+        if (channel->window.node_pool.high_water_mark > high_water_mark)
+            high_water_mark = channel->window.node_pool.high_water_mark;
+    }
+
+    PrintStr("Wakeup latency average:", fptr);
+    PrintUInt64((processed_count > 0) ? (wakeup_latency_total / processed_count) : 0, fptr);
+    PrintStr(" maximum:", fptr);
+    PrintUInt64(wakeup_latency_max, fptr);
+    PrintStr(" (microseconds)\n", fptr);
+
+    PrintStr("Alert latency average:", fptr);
+    PrintUInt64((alert_change_count > 0) ? (alert_latency_total / alert_change_count) : 0, fptr);
+    PrintStr(" maximum:", fptr);
+    PrintUInt64(alert_latency_max, fptr);
+    PrintStr(" (microseconds) changes:", fptr);
+    PrintInt((int)alert_change_count, fptr);
+    PrintStr(" lost:", fptr);
+    PrintInt((int)lost_change_count, fptr);
+    PrintStr("\n", fptr);
+
+    // The warning timer does not run in the replay mode
+    if (!IsVirtualTime())
+    {
+        PrintStr("Warning period average:", fptr);
+        PrintUInt64((warning_timer.tick_count > 0) ? (warning_timer.period_total / warning_timer.tick_count) : 0, fptr);
+        PrintStr(" minimum:", fptr);
+        PrintUInt64((warning_timer.tick_count > 0) ? warning_timer.period_min : 0, fptr);
+        PrintStr(" maximum:", fptr);
+        PrintUInt64(warning_timer.period_max, fptr);
+        PrintStr(" jitter average:", fptr);
+        PrintUInt64((warning_timer.tick_count > 0) ? (warning_timer.jitter_total / warning_timer.tick_count) : 0, fptr);
+        PrintStr(" maximum:", fptr);
+        PrintUInt64(warning_timer.jitter_max, fptr);
+        PrintStr(" (microseconds) missed ticks:", fptr);
+        PrintInt((int)warning_timer.missed_count, fptr);
+        PrintStr("\n", fptr);
+    }
+
+    PrintStr("Truncated window pulses:", fptr);
+    PrintInt((int)truncated_count, fptr);
+    PrintStr("\n", fptr);
+
+    // Exact trend windows the median mode cannot keep
+    if (median_mode != MEDIAN_MODE_HISTOGRAM)
+    {
+        bool skipped_flag = false;
+
+        for (unsigned int i = 0; i < sizeof(trend_window_lengths) / sizeof(trend_window_lengths[0]); i++)
         {
-            EnterCriticalSection(&pulse_cs);
-            new_pulse = pulse;
-            pulse.valid = false;
-            LeaveCriticalSection(&pulse_cs);
+            if (trend_window_backends[i] != TREND_BACKEND_EXACT)
+                continue;
 
-            // Check to see whether a new pulse has arrived
-            if (new_pulse.valid == true)
-            {
-                new_pulse.valid = false;
+            if (!skipped_flag)
+                PrintStr("Skipped exact trend windows:", fptr);
 
-                EnterCriticalSection(&print_cs);
-                head_ptr = DeleteStalePulses(head_ptr, new_pulse.timestamp, fptr);
-                LeaveCriticalSection(&print_cs);
+            PrintInt((int)(trend_window_lengths[i] / ONE_SEC), fptr);
+            PrintStr("s", fptr);
+            skipped_flag = true;
+        }
 
-                InsertPulse(&head_ptr, MakeNode(new_pulse));
+        if (skipped_flag)
+            PrintStr(" (histogram mode only)\n", fptr);
+    }
 
-                EnterCriticalSection(&print_cs);
-                PrintList(head_ptr, fptr);
-                LeaveCriticalSection(&print_cs);
+    PrintStr("Dropped pulses:", fptr);
+    PrintInt((int)dropped_count, fptr);
+    PrintStr("\n", fptr);
 
-                pulse_width_median = FindMedian(head_ptr);
+    // Output the logging thread could not take within its buffers
+    PrintStr("Dropped log bytes:", fptr);
+    PrintInt((int)GetLoggerDroppedBytes(), fptr);
+    PrintStr(" muted threads:", fptr);
+    PrintInt((int)GetLoggerMutedThreads(), fptr);
+    PrintStr("\n", fptr);
 
-                EnterCriticalSection(&print_cs);
-                PrintStr("Median:", fptr);
-                PrintTemp(ConvertPulseWidthToTemp(pulse_width_median), fptr);
-                LeaveCriticalSection(&print_cs);
+    if (fptr == ROLLING_LOG_FILE)
+    {
+        PrintStr("Log segments:", fptr);
+        PrintInt((int)GetRollingLogSegmentCount(), fptr);
+        PrintStr(" deleted:", fptr);
+        PrintInt((int)GetRollingLogDeletedCount(), fptr);
+        PrintStr("\n", fptr);
+    }
 
-                uint64_t current_time = GetSystemTime();
+    PrintStr("Pulses above warning threshold:", fptr);
+    PrintInt((int)above_threshold_count, fptr);
+    PrintStr(" of", fptr);
+    PrintInt((int)processed_count, fptr);
+    PrintStr(" (", fptr);
+    PrintStr(GetPulseKernelName(), fptr);
+    PrintStr(" kernels)\n", fptr);
 
-                // Check to see whether the temperature median has exceeded the temperature warning threshold
-                if (pulse_width_median > pulse_width_warning_threshold)
-                {
-                    warning_alert_flag = true;  
+    for (unsigned int i = 0; i < channel_pool.worker_count; i++)
+    {
+        ChannelWorker* worker = &channel_pool.workers[i];
+
+        PrintStr("Worker", fptr);
+        PrintInt((int)i, fptr);
+        PrintStr(" utilization:", fptr);
+        PrintInt((int)(GetWorkerUtilization(worker) * 100.0 + 0.5), fptr);
+        PrintStr("% pulses:", fptr);
+        PrintInt((int)worker->processed_count, fptr);
+        PrintStr(" work items:", fptr);
+        PrintInt((int)worker->executed_count, fptr);
+        PrintStr(" stolen:", fptr);
+        PrintInt((int)worker->stolen_count, fptr);
+        PrintStr("\n", fptr);
+    }
 
-                    EnterCriticalSection(&print_cs);
-                    PrintStr(" - Alert duration", fptr);
-                    PrintInt((int)(current_time - warning_alert_timestamp), fptr);
-                    PrintStr("\n", fptr);
-                    LeaveCriticalSection(&print_cs);
-                }
-                else
-                {
-                    warning_alert_flag = false;
-                    warning_alert_timestamp = current_time;
+    if (median_mode == MEDIAN_MODE_LIST)
+    {
+        PrintStr("Node pool high-water mark:", fptr);
+        PrintInt((int)high_water_mark, fptr);
+        PrintStr("\n", fptr);
+    }
 
-                    EnterCriticalSection(&print_cs);
-                    PrintStr("\n", fptr);
-                    LeaveCriticalSection(&print_cs);
-                }
+    // Final medians of the primary and trend windows of every channel, followed by the p90 and p99 of the trend windows
+    for (unsigned int id = 0; (channel_config.trend_window_count > 0) && (id < channel_pool.channel_count); id++)
+    {
+        Channel* channel = &channel_pool.channels[id];
 
-                EnterCriticalSection(&warning_cs);
-                warnings_on_flag = ((warning_alert_flag == true) 
-                    && (IsTimeout(current_time, warning_alert_timestamp, warning_threshold))) ? true : false;
-                LeaveCriticalSection(&warning_cs); 
-            }
+        PrintStr("Channel", fptr);
+        PrintInt((int)id, fptr);
+        PrintStr(" medians:", fptr);
+        PrintInt((int)(channel_config.window_length / ONE_SEC_IN_USEC), fptr);
+        PrintStr("s", fptr);
+        PrintTemp(ConvertDoubledPulseWidthToTemp(GetWindowMedian(&channel->window)), fptr);
 
-            Sleep(polling_time_interval);
+        for (unsigned int i = 0; i < channel_config.trend_window_count; i++)
+        {
+            PrintInt((int)(channel_config.trend_window_lengths[i] / ONE_SEC_IN_USEC), fptr);
+            PrintStr("s", fptr);
+            PrintTemp(ConvertDoubledPulseWidthToTemp(GetTrendWindowMedian(&channel->window, i)), fptr);
         }
 
-        // Command threads to exit
-        SetEvent(pulses_event_handle);
-        SetEvent(warnings_event_handle);
+        PrintStr("\n", fptr);
 
-        // Wait for the threads to finish
-        WaitForSingleObject(pulses_thread_handle, INFINITE);
-        WaitForSingleObject(warnings_thread_handle, INFINITE);
+        PrintStr("Channel", fptr);
+        PrintInt((int)id, fptr);
+        PrintStr(" p90/p99:", fptr);
 
-        // Close thread handles
-        CloseHandle(pulses_thread_handle);
-        CloseHandle(warnings_thread_handle);
+        for (unsigned int i = 0; i < channel_config.trend_window_count; i++)
+        {
+            PrintInt((int)(channel_config.trend_window_lengths[i] / ONE_SEC_IN_USEC), fptr);
+            PrintStr("s", fptr);
+            PrintTemp(ConvertDoubledPulseWidthToTemp(GetTrendWindowQuantile(&channel->window, i, QUANTILE_P90)), fptr);
+            PrintTemp(ConvertDoubledPulseWidthToTemp(GetTrendWindowQuantile(&channel->window, i, QUANTILE_P99)), fptr);
+        }
+
+        PrintStr("\n", fptr);
     }
 
-    if (fptr != NULL)
-        fclose(fptr);
+    FreeChannelPool(&channel_pool);
+    FreePeriodicTimer(&warning_timer);
+
+    CloseLogFile(fptr);
 
     return 0;
 }
 
-// This function simulates generation of temperature sensor electrical signals
-// It runs in a dedicated thread of execution
-DWORD WINAPI GeneratePulses(LPVOID ptr)
+// This function simulates the sensors of every channel in real time for the measurement duration or until a shutdown is requested
+// It starts the logging thread, the pulse and warning threads and the worker threads and stops them all once it is over.
+// The pulses are stopped first, so the queued pulses are processed and all output is flushed before the function returns.
+static void RunSimulation(FILE* fptr)
 {
     // ----- Configuration parameters -----
-    const unsigned short pulse_width_lower_limit = 30;  // Milliseconds
-    const unsigned short pulse_width_upper_limit = 80;  // Milliseconds
-    const unsigned short pulse_interval = 20;           // Milliseconds
+    const unsigned long poll_interval = 100;    // Milliseconds between checks for a shutdown request
 
-    unsigned short pulse_width = 0;
-    double pulse_temp = 0;
+    const ThreadOptions worker_options = { settings.worker_affinity ? (int)settings.first_worker_cpu : -1, settings.worker_priority };
+    const ThreadOptions pulse_options = { -1, settings.pulse_priority };
+    const ThreadOptions warning_options = { -1, settings.warning_priority };
 
-    FILE* fptr = (FILE*)ptr;
+    struct Thread* pulses_thread = NULL;
+    struct Thread* warnings_thread = NULL;
 
-    uint64_t start_time = GetSystemTime();
+    // Console and file output is written by the logging thread
+    StartLogger(fptr, GetLogSink());
 
-    while (true)
+    // Parameters: thread function, parameter to thread function, placement and scheduling priority
+    // Return: thread or NULL
+    if ((pulses_event != NULL) && (warnings_event != NULL))
     {
-        // Check exit event 
-        if (WaitForSingleObject(warnings_event_handle, 0) == WAIT_OBJECT_0)
-            return 0;
+        pulses_thread = StartThread(GeneratePulses, fptr, &pulse_options);
+        warnings_thread = StartThread(GenerateWarnings, fptr, &warning_options);
+    }
 
-        pulse_width = GeneratePulseWidth(pulse_width_lower_limit, pulse_width_upper_limit);
-        pulse_temp = ConvertPulseWidthToTemp(pulse_width);
+    if (StartChannelPool(&channel_pool, &worker_options) && (pulses_thread != NULL) && (warnings_thread != NULL))
+    {
+        // Both interrupts and termination requests shut down gracefully
+        signal(SIGINT, RequestShutdown);
+        signal(SIGTERM, RequestShutdown);
+        signal(ACKNOWLEDGE_SIGNAL, RequestAcknowledge);
+
+        uint64_t start_time = GetMonotonicTime();
+        unsigned long elapsed = 0;
+        unsigned long next_stats_time = settings.stats_interval;
+        unsigned long next_reload_time = settings.reload_interval;
+
+        // Let the worker threads process the pulses for the measurement duration, dumping the statistics 
+        // and checking the settings file for new alert thresholds periodically
+        while ((!shutdown_flag.load()) && 
+            ((settings.measurement_duration_limit == 0) || (elapsed < settings.measurement_duration_limit)))
+        {
+            unsigned long delay = poll_interval;
 
-        // Simulate signal width generation delay
-        Sleep(pulse_width);
+            if ((settings.measurement_duration_limit > 0) && ((settings.measurement_duration_limit - elapsed) < delay))
+                delay = settings.measurement_duration_limit - elapsed;
 
-        EnterCriticalSection(&pulse_cs);
+            SleepMilliseconds(delay);
+            elapsed = (unsigned long)((GetMonotonicTime() - start_time) / ONE_MSEC_IN_USEC);
 
-        pulse.valid = true; 
-        pulse.width = pulse_width;
-        pulse.temp = pulse_temp;
+            if (acknowledge_flag.exchange(false))
+                AcknowledgeChannelPoolWarnings(&channel_pool);
 
-        // Simulate exact pulse arrival time
-        pulse.timestamp = GetSystemTime();
+            if (elapsed >= next_stats_time)
+            {
+                PrintChannelPoolStats(&channel_pool);
+                next_stats_time += settings.stats_interval;
+            }
 
-        LeaveCriticalSection(&pulse_cs);
+            if ((settings.reload_interval > 0) && (elapsed >= next_reload_time))
+            {
+                next_reload_time = elapsed + settings.reload_interval;
 
-        EnterCriticalSection(&print_cs);
-        PrintStr("New:   ", fptr);
-        PrintTemp(pulse_temp, fptr);
-        PrintStr("\n", fptr);
-        LeaveCriticalSection(&print_cs);
+                if (ReloadSettingsFile(&settings))
+                {
+                    AlertThresholds thresholds;
 
-        // Simulate pulse inter-arrival time
-        Sleep(pulse_interval);
+                    GetAlertThresholds(&thresholds);
+                    PublishAlertThresholds(&threshold_state, &thresholds);
+
+                    PrintStr("Thresholds reloaded: temperature limit", fptr);
+                    PrintInt((int)settings.warning_temp_limit, fptr);
+                    PrintStr(" warning threshold", fptr);
+                    PrintInt((int)settings.warning_threshold, fptr);
+                    PrintStr(" (milliseconds)\n", fptr);
+                }
+            }
+        }
+
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(ACKNOWLEDGE_SIGNAL, SIG_DFL);
     }
 
-    return 0;
+    // Command threads to exit, the pulses first so the workers are left to drain the queues
+    if (pulses_event != NULL)
+        SignalEvent(pulses_event);
+
+    if (warnings_event != NULL)
+        SignalEvent(warnings_event);
+
+    // Wait for the threads to finish
+    JoinThread(pulses_thread);
+    JoinThread(warnings_thread);
+
+    StopChannelPool(&channel_pool);
+
+    // Raised priorities need privileges, so the threads that could not get them keep running with the defaults
+    if (GetThreadOptionFailures() > 0)
+    {
+        PrintStr("Thread options not applied:", fptr);
+        PrintInt((int)GetThreadOptionFailures(), fptr);
+        PrintStr(" threads\n", fptr);
+    }
+
+    // Flush all output before the final report is written directly
+    StopLogger();
+}
+
+// This function requests a graceful shutdown, it is called on an interrupt or termination signal
+static void RequestShutdown(int signal_number)
+{
+    (void)signal_number;
+
+    shutdown_flag.store(true);
+}
+
+// This function requests the acknowledgement of the alarms of all channels, it is called on the acknowledge signal
+static void RequestAcknowledge(int signal_number)
+{
+    (void)signal_number;
+
+    acknowledge_flag.store(true);
 }
 
+// This function converts the alert thresholds of the settings to the pulse widths and times compared by the channels
+static void GetAlertThresholds(AlertThresholds* thresholds)
+{
+    thresholds->pulse_width_warning_threshold = ThermostatCalibration::GetPulseWidthLimit(settings.warning_temp_limit);
+    thresholds->median_warning_threshold = ThermostatCalibration::GetDoubledPulseWidthLimit(settings.warning_temp_limit);
+    thresholds->warning_threshold = (uint64_t)settings.warning_threshold * ONE_MSEC_IN_USEC;
+}
 
-// This function simulates intermittent activation of the warnings in the on/off fashion
+// This function simulates generation of temperature sensor electrical signals of every channel
 // It runs in a dedicated thread of execution
-DWORD WINAPI GenerateWarnings(LPVOID ptr)
+static void GeneratePulses(void* ptr)
 {
     // ----- Configuration parameters -----
-    const unsigned short warning_duration = 5;          // Milliseconds
+    const unsigned long pulse_interval = settings.pulse_interval;   // Milliseconds
+
+    unsigned int channel_count = channel_pool.channel_count;
+    Pulse pulse = { false, 0, 0 };
 
     FILE* fptr = (FILE*)ptr;
 
-    // State machine object that governs the intermittent activation of the warnings
-    STATE_MACHINE_STRUCT state_machine;
+    // Width and arrival time of the next pulse and the simulated sensor of every channel
+    unsigned short* pulse_widths = (unsigned short*)malloc(sizeof(unsigned short) * channel_count);
+    uint64_t* arrival_times = (uint64_t*)malloc(sizeof(uint64_t) * channel_count);
+    PulseGenerator* generators = (PulseGenerator*)malloc(sizeof(PulseGenerator) * channel_count);
+
+    if ((pulse_widths == NULL) || (arrival_times == NULL) || (generators == NULL))
+    {
+        free(pulse_widths);
+        free(arrival_times);
+        free(generators);
+        return;
+    }
+
+    uint64_t current_time = GetMonotonicTime();
+
+    for (unsigned int id = 0; id < channel_count; id++)
+    {
+        InitPulseGenerator(&generators[id], &generator_config, generator_seed, id);
+        pulse_widths[id] = GeneratePulseWidth(&generators[id]);
 
-    Init(&state_machine);
+        // Simulate signal width generation delay
+        arrival_times[id] = current_time + ((uint64_t)pulse_widths[id] * ONE_MSEC_IN_USEC);
+    }
 
     while (true)
     {
-        // Check exit event 
-        if (WaitForSingleObject(warnings_event_handle, 0) == WAIT_OBJECT_0)
-            return 0;
-        
-        EnterCriticalSection(&warning_cs);
+        // Find the channel whose pulse arrives first
+        unsigned int next_id = 0;
 
-        if (warnings_on_flag == true)
+        for (unsigned int id = 1; id < channel_count; id++)
         {
-            EnterCriticalSection(&print_cs);
-            Transition(&state_machine, fptr);
-            LeaveCriticalSection(&print_cs);
+            if (arrival_times[id] < arrival_times[next_id])
+                next_id = id;
         }
-        else
+
+        current_time = GetMonotonicTime();
+
+        // Wait for the pulse arrival time while checking exit event
+        unsigned long delay = (arrival_times[next_id] > current_time) ? 
+            (unsigned long)((arrival_times[next_id] - current_time) / ONE_MSEC_IN_USEC) : 0;
+
+        if (WaitEvent(pulses_event, delay))
+            break;
+
+        pulse.valid = true; 
+        pulse.width = pulse_widths[next_id];
+
+        // Simulate exact pulse arrival time
+        pulse.timestamp = GetMonotonicTime();
+
+        SetLogChannel((int)next_id);
+
+        if (LOG_ENABLED(LOG_LEVEL_PULSE))
         {
-            Init(&state_machine);
+            PrintStr("New:   ", fptr);
+            PrintTemp(ConvertDoubledPulseWidthToTemp(2u * pulse.width), fptr);
+            PrintStr("\n", fptr);
         }
 
-        LeaveCriticalSection(&warning_cs);
+        LogBinaryRecord(RECORD_NEW_PULSE, pulse.width, 0, pulse.timestamp, fptr);
 
-        Sleep(warning_duration);
+        SubmitChannelPulse(&channel_pool, next_id, pulse);
+        SetLogChannel(LOG_CHANNEL_NONE);
+
+        // Simulate pulse inter-arrival time followed by the next signal width generation delay
+        pulse_widths[next_id] = GeneratePulseWidth(&generators[next_id]);
+        arrival_times[next_id] = pulse.timestamp + 
+            ((uint64_t)(pulse_interval + pulse_widths[next_id]) * ONE_MSEC_IN_USEC);
     }
 
-    return 0;
-}
\ No newline at end of file
+    free(pulse_widths);
+    free(arrival_times);
+    free(generators);
+}
+
+
+// This function simulates intermittent activation of the warnings of every channel in the on/off fashion
+// It runs in a dedicated thread of execution
+static void GenerateWarnings(void* ptr)
+{
+    (void)ptr;
+
+    // The deadlines are counted from the start of the thread
+    StartPeriodicTimer(&warning_timer);
+
+    while (true)
+    {
+        // Check exit event 
+        if (WaitEvent(warnings_event, 0))
+            return;
+
+        // A single timer paces the warnings of every channel
+        TickChannelPoolWarnings(&channel_pool);
+
+        WaitPeriodicTimer(&warning_timer);
+    }
+}
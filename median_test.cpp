@@ -0,0 +1,405 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module tests the median window backends against the reference linked list
+
+// Usage: MedianTest
+// Every test feeds the same reproducible pulses to the sorted linked list, the reference implementation,
+// and to a median window mode, and compares their pulse counts and medians after every update,
+// pulse by pulse or batch by batch. The exact trend windows sharing the pulse store of a histogram window 
+// are compared with references of their own lengths, including their p90 and p99; the approximate trend 
+// windows are only checked for plausible quantiles.
+// The pulse spacing varies, so the windows grow and shrink. A window too small for its pulses
+// must report the pulses it could not keep.
+// The program prints one line per test and exits with a nonzero status if any test fails.
+
+#include "functions.h"
+#include "median_window.h"
+
+#define TEST_PULSE_COUNT 20000          // Pulses fed per test
+#define TEST_MAX_SPACING 40000          // Largest spacing between consecutive pulses (microseconds)
+#define TEST_MAX_BATCH 8                // Largest number of pulses per batch
+#define TEST_WINDOW_LENGTH ONE_SEC_IN_USEC
+#define TEST_TREND_WINDOW_LENGTH (10 * ONE_SEC_IN_USEC)
+#define TEST_WINDOW_CAPACITY 4096       // Covers the trend window at the smallest average spacing
+#define TEST_TRUNCATION_CAPACITY 16     // Far fewer than the pulses of the window at the average spacing
+#define TEST_TREND_TRUNCATION_CAPACITY 128  // Covers the window, but not the trend window at the average spacing
+
+// Reference window, a sorted linked list with heap allocated nodes
+typedef struct
+{
+    struct Node* head_ptr;
+    MedianTracker median_tracker;
+    uint64_t window_length;             // Microseconds
+} ReferenceWindow;
+
+// Pseudo-random pulse source, reproducible on every platform
+static uint32_t test_seed;
+
+// Purpose: This utility function draws the next pseudo-random number
+static uint32_t NextRandom()
+{
+    test_seed = test_seed * 1664525u + 1013904223u;
+
+    return test_seed >> 8;
+}
+
+// Purpose: This utility function produces the next pulse
+// Params: The arrival time of the previous pulse (microseconds)
+// Returns: A pulse within the pulse width range, arriving up to TEST_MAX_SPACING after the previous one
+static Pulse NextPulse(uint64_t timestamp)
+{
+    Pulse pulse;
+
+    pulse.valid = true;
+    pulse.width = (unsigned short)(pulse_width_lower_limit +
+        NextRandom() % (pulse_width_upper_limit - pulse_width_lower_limit + 1));
+    pulse.timestamp = timestamp + 1 + NextRandom() % TEST_MAX_SPACING;
+
+    return pulse;
+}
+
+// Purpose: This utility function initializes the reference window
+static void InitReferenceWindow(ReferenceWindow* reference, uint64_t window_length)
+{
+    reference->head_ptr = NULL;
+    reference->window_length = window_length;
+    InitMedianTracker(&reference->median_tracker);
+}
+
+// Purpose: This utility function releases the pulses of the reference window
+static void FreeReferenceWindow(ReferenceWindow* reference)
+{
+    reference->head_ptr = DeleteStalePulses(reference->head_ptr, UINT64_MAX, 0, NULL, &reference->median_tracker, NULL);
+}
+
+// Purpose: This utility function evicts the stale pulses of the reference window and adds a new pulse
+static void AddReferencePulse(ReferenceWindow* reference, Pulse pulse)
+{
+    reference->head_ptr = DeleteStalePulses(reference->head_ptr, pulse.timestamp, reference->window_length,
+        NULL, &reference->median_tracker, NULL);
+    InsertPulse(&reference->head_ptr, MakeNode(NULL, pulse), &reference->median_tracker);
+}
+
+// Purpose: This utility function retrieves a quantile of the reference window by walking the sorted list
+// The quantile is the pulse width of the nearest rank, the smallest rank covering p of the pulses
+// Returns: Twice the quantile pulse width or 0 if the window is empty
+static unsigned int GetReferenceQuantile(const ReferenceWindow* reference, double p)
+{
+    unsigned int count = reference->median_tracker.count;
+
+    if (count == 0)
+        return 0;
+
+    double position = p * count;
+    unsigned int rank = (unsigned int)position;
+
+    if ((rank > 0) && ((double)rank == position))
+        rank--;
+
+    const struct Node* node_ptr = reference->head_ptr;
+
+    for (unsigned int i = 0; (i < rank) && (node_ptr->next != NULL); i++)
+        node_ptr = node_ptr->next;
+
+    return 2u * node_ptr->pulse.width;
+}
+
+// Purpose: This utility function reports a mismatch between a backend and the reference
+// Returns: False
+static bool ReportMismatch(const char* test_name, const char* value_name, unsigned int pulse_index,
+    unsigned int expected, unsigned int actual)
+{
+    printf("FAIL %s: %s after pulse %u is %u, expected %u\n", test_name, value_name, pulse_index, actual, expected);
+
+    return false;
+}
+
+// Purpose: This function tests a median window mode pulse by pulse
+// Params: The test name and the median window mode
+// Returns: True if the medians always match the reference; false otherwise
+static bool TestWindowMode(const char* test_name, MEDIAN_MODE mode)
+{
+    ReferenceWindow reference;
+    MedianWindow window;
+    uint64_t timestamp = 0;
+    bool pass_flag = true;
+
+    InitReferenceWindow(&reference, TEST_WINDOW_LENGTH);
+
+    if (!InitMedianWindow(&window, mode, pulse_width_lower_limit, pulse_width_upper_limit,
+        TEST_WINDOW_CAPACITY, TEST_WINDOW_LENGTH))
+    {
+        printf("FAIL %s: Cannot allocate the window\n", test_name);
+        return false;
+    }
+
+    for (unsigned int i = 0; pass_flag && (i < TEST_PULSE_COUNT); i++)
+    {
+        Pulse pulse = NextPulse(timestamp);
+
+        timestamp = pulse.timestamp;
+
+        AddReferencePulse(&reference, pulse);
+        EvictStaleWindowPulses(&window, pulse.timestamp, NULL);
+        AddWindowPulse(&window, pulse, NULL);
+
+        if (GetWindowPulseCount(&window) != reference.median_tracker.count)
+            pass_flag = ReportMismatch(test_name, "pulse count", i, reference.median_tracker.count, GetWindowPulseCount(&window));
+        else if (GetWindowMedian(&window) != FindMedian(&reference.median_tracker))
+            pass_flag = ReportMismatch(test_name, "median", i, FindMedian(&reference.median_tracker), GetWindowMedian(&window));
+    }
+
+    FreeMedianWindow(&window);
+    FreeReferenceWindow(&reference);
+
+    return pass_flag;
+}
+
+// Purpose: This function tests the batch ingest of a median window mode
+// Every batch is evicted against its youngest pulse and added at once, as a channel drains its queue
+// Params: The test name and the median window mode
+// Returns: True if the medians after every batch match the reference; false otherwise
+static bool TestBatchIngest(const char* test_name, MEDIAN_MODE mode)
+{
+    ReferenceWindow reference;
+    MedianWindow window;
+    Pulse pulses[TEST_MAX_BATCH];
+    uint64_t timestamp = 0;
+    bool pass_flag = true;
+
+    InitReferenceWindow(&reference, TEST_WINDOW_LENGTH);
+
+    if (!InitMedianWindow(&window, mode, pulse_width_lower_limit, pulse_width_upper_limit,
+        TEST_WINDOW_CAPACITY, TEST_WINDOW_LENGTH))
+    {
+        printf("FAIL %s: Cannot allocate the window\n", test_name);
+        return false;
+    }
+
+    for (unsigned int i = 0; pass_flag && (i < TEST_PULSE_COUNT); )
+    {
+        unsigned int count = 1 + NextRandom() % TEST_MAX_BATCH;
+
+        for (unsigned int j = 0; j < count; j++)
+        {
+            pulses[j] = NextPulse(timestamp);
+            timestamp = pulses[j].timestamp;
+            AddReferencePulse(&reference, pulses[j]);
+        }
+
+        EvictStaleWindowPulses(&window, pulses[count - 1].timestamp, NULL);
+        AddWindowPulses(&window, pulses, count, NULL);
+        i += count;
+
+        if (GetWindowPulseCount(&window) != reference.median_tracker.count)
+            pass_flag = ReportMismatch(test_name, "pulse count", i - 1, reference.median_tracker.count, GetWindowPulseCount(&window));
+        else if (GetWindowMedian(&window) != FindMedian(&reference.median_tracker))
+            pass_flag = ReportMismatch(test_name, "median", i - 1, FindMedian(&reference.median_tracker), GetWindowMedian(&window));
+    }
+
+    FreeMedianWindow(&window);
+    FreeReferenceWindow(&reference);
+
+    return pass_flag;
+}
+
+// Purpose: This function tests the windows sharing the pulse store of a histogram window
+// The histogram window has an exact and an approximate trend window; the exact one must match
+// a reference of its own length, including its p90 and p99, while the primary window keeps matching
+// the reference of its length
+// Params: The test name and the median window mode, which must support exact trend windows
+// Returns: True if every window matches its reference; false otherwise
+static bool TestTrendWindows(const char* test_name, MEDIAN_MODE mode)
+{
+    ReferenceWindow reference;
+    ReferenceWindow trend_reference;
+    MedianWindow window;
+    uint64_t timestamp = 0;
+    bool pass_flag = true;
+
+    InitReferenceWindow(&reference, TEST_WINDOW_LENGTH);
+    InitReferenceWindow(&trend_reference, TEST_TREND_WINDOW_LENGTH);
+
+    if ((!InitMedianWindow(&window, mode, pulse_width_lower_limit, pulse_width_upper_limit,
+        TEST_WINDOW_CAPACITY, TEST_WINDOW_LENGTH)) ||
+        (!AddTrendWindow(&window, TEST_TREND_WINDOW_LENGTH, TREND_BACKEND_EXACT)) ||
+        (!AddTrendWindow(&window, 6 * TEST_TREND_WINDOW_LENGTH, TREND_BACKEND_QUANTILE)))
+    {
+        printf("FAIL %s: Cannot allocate the windows\n", test_name);
+        return false;
+    }
+
+    for (unsigned int i = 0; pass_flag && (i < TEST_PULSE_COUNT); i++)
+    {
+        Pulse pulse = NextPulse(timestamp);
+
+        timestamp = pulse.timestamp;
+
+        AddReferencePulse(&reference, pulse);
+        AddReferencePulse(&trend_reference, pulse);
+        EvictStaleWindowPulses(&window, pulse.timestamp, NULL);
+        AddWindowPulse(&window, pulse, NULL);
+
+        if (GetWindowMedian(&window) != FindMedian(&reference.median_tracker))
+            pass_flag = ReportMismatch(test_name, "median", i, FindMedian(&reference.median_tracker), GetWindowMedian(&window));
+        else if (GetTrendWindowMedian(&window, 0) != FindMedian(&trend_reference.median_tracker))
+            pass_flag = ReportMismatch(test_name, "trend median", i, FindMedian(&trend_reference.median_tracker),
+                GetTrendWindowMedian(&window, 0));
+        else if (GetTrendWindowQuantile(&window, 0, QUANTILE_P90) != GetReferenceQuantile(&trend_reference, 0.9))
+            pass_flag = ReportMismatch(test_name, "trend p90", i, GetReferenceQuantile(&trend_reference, 0.9),
+                GetTrendWindowQuantile(&window, 0, QUANTILE_P90));
+        else if (GetTrendWindowQuantile(&window, 0, QUANTILE_P99) != GetReferenceQuantile(&trend_reference, 0.99))
+            pass_flag = ReportMismatch(test_name, "trend p99", i, GetReferenceQuantile(&trend_reference, 0.99),
+                GetTrendWindowQuantile(&window, 0, QUANTILE_P99));
+    }
+
+    // The approximate quantiles must be ordered and within the pulse width range
+    unsigned int p50 = GetTrendWindowQuantile(&window, 1, QUANTILE_P50);
+    unsigned int p90 = GetTrendWindowQuantile(&window, 1, QUANTILE_P90);
+    unsigned int p99 = GetTrendWindowQuantile(&window, 1, QUANTILE_P99);
+
+    if (pass_flag && ((p50 < 2u * pulse_width_lower_limit) || (p50 > p90) || (p90 > p99) ||
+        (p99 > 2u * pulse_width_upper_limit)))
+    {
+        printf("FAIL %s: Approximate quantiles %u %u %u are out of order or range\n", test_name, p50, p90, p99);
+        pass_flag = false;
+    }
+
+    if (pass_flag && (GetWindowTruncatedCount(&window) != 0))
+    {
+        printf("FAIL %s: %lu pulses truncated by a sufficient pulse store\n", test_name, GetWindowTruncatedCount(&window));
+        pass_flag = false;
+    }
+
+    FreeMedianWindow(&window);
+    FreeReferenceWindow(&reference);
+    FreeReferenceWindow(&trend_reference);
+
+    return pass_flag;
+}
+
+// Purpose: This function tests that a pulse store too small for its trend window reports the truncated pulses
+// Params: The test name and the median window mode, which must support exact trend windows
+// Returns: True if pulses have been reported as truncated; false otherwise
+static bool TestTrendTruncation(const char* test_name, MEDIAN_MODE mode)
+{
+    MedianWindow window;
+    uint64_t timestamp = 0;
+
+    // The pulse store covers the primary window, but the trend window holds about 500 pulses at the average spacing
+    if ((!InitMedianWindow(&window, mode, pulse_width_lower_limit, pulse_width_upper_limit,
+        TEST_TREND_TRUNCATION_CAPACITY, TEST_WINDOW_LENGTH)) || 
+        (!AddTrendWindow(&window, TEST_TREND_WINDOW_LENGTH, TREND_BACKEND_EXACT)))
+    {
+        printf("FAIL %s: Cannot allocate the windows\n", test_name);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < TEST_PULSE_COUNT; i++)
+    {
+        Pulse pulse = NextPulse(timestamp);
+
+        timestamp = pulse.timestamp;
+
+        EvictStaleWindowPulses(&window, pulse.timestamp, NULL);
+        AddWindowPulse(&window, pulse, NULL);
+    }
+
+    unsigned long truncated_count = GetWindowTruncatedCount(&window);
+
+    FreeMedianWindow(&window);
+
+    if (truncated_count == 0)
+    {
+        printf("FAIL %s: No pulses reported as truncated\n", test_name);
+        return false;
+    }
+
+    return true;
+}
+
+// Purpose: This function tests that a window too small for its pulses reports the truncated pulses
+// Params: The test name and the median window mode
+// Returns: True if pulses have been reported as truncated; false otherwise
+static bool TestTruncation(const char* test_name, MEDIAN_MODE mode)
+{
+    MedianWindow window;
+    uint64_t timestamp = 0;
+
+    // The window holds about 50 pulses at the average spacing
+    if (!InitMedianWindow(&window, mode, pulse_width_lower_limit, pulse_width_upper_limit,
+        TEST_TRUNCATION_CAPACITY, TEST_WINDOW_LENGTH))
+    {
+        printf("FAIL %s: Cannot allocate the window\n", test_name);
+        return false;
+    }
+
+    for (unsigned int i = 0; i < TEST_PULSE_COUNT; i++)
+    {
+        Pulse pulse = NextPulse(timestamp);
+
+        timestamp = pulse.timestamp;
+
+        EvictStaleWindowPulses(&window, pulse.timestamp, NULL);
+        AddWindowPulse(&window, pulse, NULL);
+    }
+
+    unsigned long truncated_count = GetWindowTruncatedCount(&window);
+
+    FreeMedianWindow(&window);
+
+    if (truncated_count == 0)
+    {
+        printf("FAIL %s: No pulses reported as truncated\n", test_name);
+        return false;
+    }
+
+    return true;
+}
+
+// Test case
+typedef struct
+{
+    const char* name;
+    MEDIAN_MODE mode;
+    bool (*func)(const char*, MEDIAN_MODE);
+} TestCase;
+
+static const TestCase test_cases[] =
+{
+    // Test name              Median mode             Test function
+    { "heap",                 MEDIAN_MODE_HEAP,       TestWindowMode },
+    { "histogram",            MEDIAN_MODE_HISTOGRAM,  TestWindowMode },
+    { "list pool",            MEDIAN_MODE_LIST,       TestWindowMode },
+    { "heap batch",           MEDIAN_MODE_HEAP,       TestBatchIngest },
+    { "histogram batch",      MEDIAN_MODE_HISTOGRAM,  TestBatchIngest },
+    { "trend windows",        MEDIAN_MODE_HISTOGRAM,  TestTrendWindows },
+    { "heap truncation",      MEDIAN_MODE_HEAP,       TestTruncation },
+    { "histogram truncation", MEDIAN_MODE_HISTOGRAM,  TestTruncation },
+    { "list truncation",      MEDIAN_MODE_LIST,       TestTruncation },
+    { "trend truncation",     MEDIAN_MODE_HISTOGRAM,  TestTrendTruncation }
+};
+
+int main()
+{
+    // The windows must not log their evictions and window dumps
+    SetLogLevel(LOG_LEVEL_NONE);
+
+    unsigned int failed_count = 0;
+
+    for (const TestCase& test_case : test_cases)
+    {
+        // Every test sees the same pulses
+        test_seed = 12345u;
+
+        if (test_case.func(test_case.name, test_case.mode))
+            printf("PASS %s\n", test_case.name);
+        else
+            failed_count++;
+    }
+
+    printf("%u of %u tests failed\n", failed_count, (unsigned int)(sizeof(test_cases) / sizeof(test_cases[0])));
+
+    return (failed_count > 0) ? 1 : 0;
+}
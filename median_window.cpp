@@ -0,0 +1,283 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements selectable median window
+
+#include "median_window.h"
+#include "binary_log.h"
+
+// Purpose: This function initializes median window
+// Params: A pointer to the window, median calculation mode, pulse width range boundaries (milliseconds), 
+// maximum number of pulses in the window and window length (microseconds)
+// The list mode draws its nodes from a pool of the given capacity
+// Returns: True if the window storage has been allocated; false otherwise
+bool InitMedianWindow(MedianWindow* window, MEDIAN_MODE mode, unsigned short lower, unsigned short upper, 
+    unsigned int capacity, uint64_t window_length)
+{
+    memset(window, 0, sizeof(MedianWindow));
+    window->mode = mode;
+    window->window_length = window_length;
+
+    switch (mode)
+    {
+    case MEDIAN_MODE_LIST:
+        InitMedianTracker(&window->median_tracker);
+        return InitNodePool(&window->node_pool, capacity);
+    case MEDIAN_MODE_HEAP:
+        return InitSlidingMedian(&window->sliding_median, capacity, window_length);
+    case MEDIAN_MODE_HISTOGRAM:
+        return InitHistogramMedian(&window->histogram_median, lower, upper, capacity, window_length);
+    }
+
+    return false;
+}
+
+// Purpose: This function releases median window storage
+void FreeMedianWindow(MedianWindow* window)
+{
+    switch (window->mode)
+    {
+    case MEDIAN_MODE_LIST:
+        window->head_ptr = NULL;
+        InitMedianTracker(&window->median_tracker);
+        FreeNodePool(&window->node_pool);
+        break;
+    case MEDIAN_MODE_HEAP:
+        FreeSlidingMedian(&window->sliding_median);
+        break;
+    case MEDIAN_MODE_HISTOGRAM:
+        FreeHistogramMedian(&window->histogram_median);
+        break;
+    }
+}
+
+// Purpose: This function evicts pulses with stale data, if any are found
+// Params: A pointer to the window and the youngest timestamp
+// Returns: The number of evicted pulses of the window; the approximate trend windows store no pulses and evict none
+unsigned int EvictStaleWindowPulses(MedianWindow* window, uint64_t timestamp, FILE* fptr)
+{
+    unsigned int count = 0;
+
+    // Exact trend windows are evicted along with the histogram window
+    for (unsigned int i = 0; i < window->trend_window_count; i++)
+    {
+        if (window->trend_windows[i].backend == TREND_BACKEND_QUANTILE)
+            EvictStaleQuantilePulses(&window->trend_windows[i].quantile_window, timestamp);
+    }
+
+    switch (window->mode)
+    {
+    case MEDIAN_MODE_LIST:
+        count = window->median_tracker.count;
+        window->head_ptr = DeleteStalePulses(window->head_ptr, timestamp, window->window_length, 
+            &window->node_pool, &window->median_tracker, fptr);
+        return count - window->median_tracker.count;
+    case MEDIAN_MODE_HEAP:
+        return EvictStalePulses(&window->sliding_median, timestamp, fptr);
+    case MEDIAN_MODE_HISTOGRAM:
+        return EvictStaleHistogramPulses(&window->histogram_median, timestamp, fptr);
+    }
+
+    return count;
+}
+
+// Purpose: This utility function adds a new pulse to the approximate trend windows
+// Exact trend windows are fed along with the histogram window
+static void AddQuantileTrendPulse(MedianWindow* window, Pulse pulse)
+{
+    for (unsigned int i = 0; i < window->trend_window_count; i++)
+    {
+        if (window->trend_windows[i].backend == TREND_BACKEND_QUANTILE)
+            AddQuantilePulse(&window->trend_windows[i].quantile_window, pulse);
+    }
+}
+
+// Purpose: This function adds a new pulse to the window
+// Pulses a full pulse store drops to make room are recorded in the binary log as stale pulses
+// Params: A pointer to the window, a pulse with the youngest timestamp and the log file pointer
+void AddWindowPulse(MedianWindow* window, Pulse pulse, FILE* fptr)
+{
+    AddQuantileTrendPulse(window, pulse);
+
+    switch (window->mode)
+    {
+    case MEDIAN_MODE_LIST:
+        InsertPulse(&window->head_ptr, MakeNode(&window->node_pool, pulse), &window->median_tracker);
+        break;
+    case MEDIAN_MODE_HEAP:
+        AddPulse(&window->sliding_median, pulse, fptr);
+        break;
+    case MEDIAN_MODE_HISTOGRAM:
+        AddHistogramPulse(&window->histogram_median, pulse, fptr);
+        break;
+    }
+}
+
+// Purpose: This function adds a batch of pulses to the window
+// The window is expected to have been evicted against the youngest pulse of the batch, so pulses of the batch 
+// that are already stale relative to the youngest pulse are skipped rather than added and evicted again; 
+// the approximate trend windows, which are far longer, still take them.
+// Every added pulse but the youngest is recorded in the binary log; the youngest goes with the median record.
+// Params: A pointer to the window, time-ordered pulses, the number of pulses and the log file pointer
+// Returns: The number of skipped pulses
+unsigned int AddWindowPulses(MedianWindow* window, const Pulse* pulses, unsigned int count, FILE* fptr)
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t timestamp = pulses[count - 1].timestamp;
+    unsigned int skipped_count = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if ((pulses[i].timestamp + window->window_length) < timestamp)
+        {
+            AddQuantileTrendPulse(window, pulses[i]);
+            skipped_count++;
+            continue;
+        }
+
+        AddWindowPulse(window, pulses[i], fptr);
+
+        if (i < (count - 1))
+            LogBinaryRecord(RECORD_BATCH_PULSE, pulses[i].width, 0, pulses[i].timestamp, fptr);
+    }
+
+    return skipped_count;
+}
+
+// Purpose: This function retrieves the median pulse width of the window
+// Returns: Twice the median pulse width or 0 if the window is empty
+unsigned int GetWindowMedian(const MedianWindow* window)
+{
+    switch (window->mode)
+    {
+    case MEDIAN_MODE_LIST:
+        return FindMedian(&window->median_tracker);
+    case MEDIAN_MODE_HEAP:
+        return GetMedian(&window->sliding_median);
+    case MEDIAN_MODE_HISTOGRAM:
+        return GetHistogramMedian(&window->histogram_median);
+    }
+
+    return 0;
+}
+
+// Purpose: This function retrieves the number of pulses in the window
+// Returns: The number of pulses
+unsigned int GetWindowPulseCount(const MedianWindow* window)
+{
+    switch (window->mode)
+    {
+    case MEDIAN_MODE_LIST:
+        return window->median_tracker.count;
+    case MEDIAN_MODE_HEAP:
+        return window->sliding_median.lower_count + window->sliding_median.upper_count;
+    case MEDIAN_MODE_HISTOGRAM:
+        return window->histogram_median.windows[0].count;
+    }
+
+    return 0;
+}
+
+// Purpose: This function retrieves the number of pulses a full pulse store could not keep until they became stale
+// Such pulses are missing from the window or from an exact trend window, so a nonzero count means 
+// the window capacity does not cover the longest window at the actual pulse rate
+// Returns: The number of truncated pulses; in the list mode the number of new pulses dropped by an exhausted node pool
+unsigned long GetWindowTruncatedCount(const MedianWindow* window)
+{
+    switch (window->mode)
+    {
+    case MEDIAN_MODE_LIST:
+        return window->node_pool.exhausted_count;
+    case MEDIAN_MODE_HEAP:
+        return window->sliding_median.truncated_count;
+    case MEDIAN_MODE_HISTOGRAM:
+        return window->histogram_median.truncated_count;
+    }
+
+    return 0;
+}
+
+// Purpose: This function prints contents of the window in the ascending order
+void PrintMedianWindow(const MedianWindow* window, FILE* fptr)
+{
+    switch (window->mode)
+    {
+    case MEDIAN_MODE_LIST:
+        PrintList(window->head_ptr, fptr);
+        break;
+    case MEDIAN_MODE_HEAP:
+        PrintSlidingMedian(&window->sliding_median, fptr);
+        break;
+    case MEDIAN_MODE_HISTOGRAM:
+        PrintHistogramMedian(&window->histogram_median, fptr);
+        break;
+    }
+}
+
+// Purpose: This function adds a trend window of another length fed by the same pulses
+// Exact trend windows share the time-ordered pulse store, hence they are supported in the histogram mode only 
+// and the window capacity must cover the longest exact trend window
+// Params: A pointer to the window, trend window length (microseconds) and the trend window backend
+// Returns: True if the trend window has been added; false otherwise
+bool AddTrendWindow(MedianWindow* window, uint64_t window_length, TREND_BACKEND backend)
+{
+    if (window->trend_window_count == MAX_TREND_WINDOWS)
+        return false;
+
+    TrendWindow* trend_window = &window->trend_windows[window->trend_window_count];
+
+    trend_window->backend = backend;
+
+    switch (backend)
+    {
+    case TREND_BACKEND_EXACT:
+        if (window->mode != MEDIAN_MODE_HISTOGRAM)
+            return false;
+
+        trend_window->histogram_index = window->histogram_median.window_count;
+
+        if (!AddHistogramWindow(&window->histogram_median, window_length))
+            return false;
+        break;
+    case TREND_BACKEND_QUANTILE:
+        InitQuantileWindow(&trend_window->quantile_window, window_length);
+        break;
+    default:
+        return false;
+    }
+
+    window->trend_window_count++;
+
+    return true;
+}
+
+// Purpose: This function retrieves the median pulse width of a trend window
+// Params: A pointer to the window and the zero-based trend window index in the order of addition
+// Returns: Twice the median pulse width or 0 if the trend window is empty or does not exist
+unsigned int GetTrendWindowMedian(const MedianWindow* window, unsigned int trend_index)
+{
+    return GetTrendWindowQuantile(window, trend_index, QUANTILE_P50);
+}
+
+// Purpose: This function retrieves a quantile of the pulse widths of a trend window
+// Exact trend windows report the pulse width of the quantile rank; the median is the mean of the middle pulses
+// Params: A pointer to the window, the zero-based trend window index in the order of addition and the quantile
+// Returns: Twice the quantile pulse width or 0 if the trend window is empty or does not exist
+unsigned int GetTrendWindowQuantile(const MedianWindow* window, unsigned int trend_index, QUANTILE quantile)
+{
+    if (trend_index >= window->trend_window_count)
+        return 0;
+
+    const TrendWindow* trend_window = &window->trend_windows[trend_index];
+
+    if (trend_window->backend == TREND_BACKEND_QUANTILE)
+        return GetQuantile(&trend_window->quantile_window, quantile);
+
+    if (quantile == QUANTILE_P50)
+        return GetHistogramWindowMedian(&window->histogram_median, trend_window->histogram_index);
+
+    return GetHistogramWindowQuantile(&window->histogram_median, trend_window->histogram_index, 
+        GetQuantileProbability(quantile));
+}
@@ -0,0 +1,70 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines selectable median window
+
+#pragma once
+
+#include "functions.h"
+#include "sliding_median.h"
+#include "histogram_median.h"
+#include "quantile_window.h"
+#include "node_pool.h"
+
+// Uncomment to cross check the median window against the reference linked list implementation
+// #define VERIFY_MEDIAN
+
+#define MAX_TREND_WINDOWS (MAX_HISTOGRAM_WINDOWS - 1)
+
+// Median calculation modes
+typedef enum {
+    MEDIAN_MODE_LIST,           // Sorted linked list (reference implementation)
+    MEDIAN_MODE_HEAP,           // Two heaps, O(log n) per pulse
+    MEDIAN_MODE_HISTOGRAM       // Counting histogram over the bounded pulse width range, O(1) per pulse
+} MEDIAN_MODE;
+
+// Trend window backends
+typedef enum {
+    TREND_BACKEND_EXACT,        // Counting histogram sharing the pulse store of the window (histogram mode only)
+    TREND_BACKEND_QUANTILE      // Approximate P-square quantiles in constant memory, for windows of minutes
+} TREND_BACKEND;
+
+// Trend window fed by the same pulses as the window
+typedef struct
+{
+    TREND_BACKEND backend;
+    unsigned int histogram_index;       // Index of the histogram window of an exact trend window
+    QuantileWindow quantile_window;     // Quantiles of an approximate trend window
+} TrendWindow;
+
+// Median window holds the pulses of the current time window using the selected median calculation mode
+// Longer trend windows can be added, each with a backend of its own: exact trend windows share 
+// the pulse store of a histogram window, while approximate ones store no pulses at all. 
+// The window itself stays exact whatever its trend windows are, since it drives the alerts.
+typedef struct
+{
+    MEDIAN_MODE mode;
+    uint64_t window_length;             // Microseconds
+    struct Node* head_ptr;
+    MedianTracker median_tracker;
+    struct NodePool node_pool;
+    SlidingMedian sliding_median;
+    HistogramMedian histogram_median;
+    TrendWindow trend_windows[MAX_TREND_WINDOWS];
+    unsigned int trend_window_count;
+} MedianWindow;
+
+// Function declarations
+bool InitMedianWindow(MedianWindow* window, MEDIAN_MODE mode, unsigned short lower, unsigned short upper, 
+    unsigned int capacity, uint64_t window_length);
+void FreeMedianWindow(MedianWindow* window);
+unsigned int EvictStaleWindowPulses(MedianWindow* window, uint64_t timestamp, FILE* fptr);
+void AddWindowPulse(MedianWindow* window, Pulse pulse, FILE* fptr);
+unsigned int AddWindowPulses(MedianWindow* window, const Pulse* pulses, unsigned int count, FILE* fptr);
+unsigned int GetWindowMedian(const MedianWindow* window);
+unsigned int GetWindowPulseCount(const MedianWindow* window);
+unsigned long GetWindowTruncatedCount(const MedianWindow* window);
+void PrintMedianWindow(const MedianWindow* window, FILE* fptr);
+bool AddTrendWindow(MedianWindow* window, uint64_t window_length, TREND_BACKEND backend);
+unsigned int GetTrendWindowMedian(const MedianWindow* window, unsigned int trend_index);
+unsigned int GetTrendWindowQuantile(const MedianWindow* window, unsigned int trend_index, QUANTILE quantile);
@@ -0,0 +1,72 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements linked list node pool
+
+#include "node_pool.h"
+
+// Purpose: This function initializes node pool
+// Params: A pointer to the pool and maximum number of nodes (the maximum number of pulses per window)
+// Returns: True if the pool storage has been allocated; false otherwise
+bool InitNodePool(struct NodePool* pool, unsigned int capacity)
+{
+    pool->nodes = (capacity > 0) ? (struct Node*)malloc(sizeof(struct Node) * capacity) : NULL;
+    pool->free_ptr = NULL;
+    pool->capacity = (pool->nodes != NULL) ? capacity : 0;
+    pool->in_use = 0;
+    pool->high_water_mark = 0;
+    pool->exhausted_count = 0;
+
+    // Thread all nodes onto the free list
+    for (unsigned int i = pool->capacity; i > 0; i--)
+    {
+        pool->nodes[i - 1].next = pool->free_ptr;
+        pool->free_ptr = &pool->nodes[i - 1];
+    }
+
+    return (pool->nodes != NULL);
+}
+
+// Purpose: This function releases node pool storage
+// All nodes taken from the pool become invalid
+void FreeNodePool(struct NodePool* pool)
+{
+    free(pool->nodes);
+
+    pool->nodes = NULL;
+    pool->free_ptr = NULL;
+    pool->capacity = 0;
+    pool->in_use = 0;
+}
+
+// Purpose: This function takes a node from the pool
+// Returns: A node or NULL if the pool is exhausted
+struct Node* TakeNode(struct NodePool* pool)
+{
+    struct Node* node_ptr = pool->free_ptr;
+
+    if (node_ptr == NULL)
+    {
+        pool->exhausted_count++;
+        return NULL;
+    }
+
+    pool->free_ptr = node_ptr->next;
+    pool->in_use++;
+
+    if (pool->in_use > pool->high_water_mark)
+        pool->high_water_mark = pool->in_use;
+
+    return node_ptr;
+}
+
+// Purpose: This function gives a node back to the pool
+void ReturnNode(struct NodePool* pool, struct Node* node_ptr)
+{
+    if (node_ptr != NULL)
+    {
+        node_ptr->next = pool->free_ptr;
+        pool->free_ptr = node_ptr;
+        pool->in_use--;
+    }
+}
@@ -0,0 +1,29 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines linked list node pool
+
+#pragma once
+
+#include "functions.h"
+
+// The node pool is a fixed-capacity arena of linked list nodes allocated once at startup.
+// Free nodes are threaded through their next pointers, so taking a node from the pool 
+// and giving it back are constant time operations without any heap traffic.
+
+// Linked list node pool
+struct NodePool
+{
+    struct Node* nodes;             // Arena of nodes
+    struct Node* free_ptr;          // Head of the free list
+    unsigned int capacity;          // Number of nodes in the arena
+    unsigned int in_use;            // Number of nodes currently taken from the pool
+    unsigned int high_water_mark;   // Largest number of nodes taken from the pool at once
+    unsigned long exhausted_count;  // Number of requests that found the pool empty
+};
+
+// Function declarations
+bool InitNodePool(struct NodePool* pool, unsigned int capacity);
+void FreeNodePool(struct NodePool* pool);
+struct Node* TakeNode(struct NodePool* pool);
+void ReturnNode(struct NodePool* pool, struct Node* node_ptr);
@@ -0,0 +1,86 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements drift-free periodic timer
+
+#include "periodic_timer.h"
+
+// Purpose: This function initializes periodic timer
+// Params: A pointer to the timer and the period in microseconds
+// Returns: True if the deadline timer has been created; false otherwise
+bool InitPeriodicTimer(PeriodicTimer* timer, uint64_t period)
+{
+    timer->timer = NewTimer();
+
+    if (timer->timer == NULL)
+        return false;
+
+    timer->period = period;
+    StartPeriodicTimer(timer);
+
+    return true;
+}
+
+// Purpose: This function releases periodic timer
+void FreePeriodicTimer(PeriodicTimer* timer)
+{
+    FreeTimer(timer->timer);
+    timer->timer = NULL;
+}
+
+// Purpose: This function restarts the deadlines and statistics of periodic timer from the current time
+// The first tick is due one period later
+void StartPeriodicTimer(PeriodicTimer* timer)
+{
+    uint64_t current_time = GetMonotonicTime();
+
+    timer->next_deadline = current_time + timer->period;
+    timer->last_tick_time = current_time;
+    timer->tick_count = 0;
+    timer->missed_count = 0;
+    timer->period_total = 0;
+    timer->period_min = UINT64_MAX;
+    timer->period_max = 0;
+    timer->jitter_total = 0;
+    timer->jitter_max = 0;
+}
+
+// Purpose: This function blocks until the next deadline of periodic timer and records the achieved period and jitter
+void WaitPeriodicTimer(PeriodicTimer* timer)
+{
+    uint64_t current_time = GetMonotonicTime();
+
+    if (current_time < timer->next_deadline)
+    {
+        WaitTimer(timer->timer, timer->next_deadline);
+        current_time = GetMonotonicTime();
+    }
+
+    uint64_t jitter = (current_time > timer->next_deadline) ? (current_time - timer->next_deadline) : 0;
+    uint64_t period = current_time - timer->last_tick_time;
+
+    timer->tick_count++;
+    timer->jitter_total += jitter;
+    timer->period_total += period;
+
+    if (jitter > timer->jitter_max)
+        timer->jitter_max = jitter;
+
+    if (period < timer->period_min)
+        timer->period_min = period;
+
+    if (period > timer->period_max)
+        timer->period_max = period;
+
+    timer->last_tick_time = current_time;
+    timer->next_deadline += timer->period;
+
+    // Skip the deadlines that have already passed
+    if (current_time >= timer->next_deadline)
+    {
+        uint64_t missed_count = (current_time - timer->next_deadline) / timer->period + 1;
+
+        timer->missed_count += (unsigned long)missed_count;
+        timer->next_deadline += missed_count * timer->period;
+    }
+}
@@ -0,0 +1,37 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines drift-free periodic timer
+
+#pragma once
+
+#include "functions.h"
+#include "platform.h"
+
+// A periodic timer wakes its thread at absolute deadlines that are a whole number of periods apart. 
+// Every wait is armed for the time remaining until the next deadline, so neither the work done between 
+// the waits nor the lateness of a wakeup accumulates into drift. A thread that falls behind by more than 
+// a period skips the deadlines it has missed instead of ticking in a burst to catch up.
+// The waits use the deadline timer of the platform layer, a high-resolution waitable timer where the system provides one.
+
+// Periodic timer
+typedef struct
+{
+    struct Timer* timer;            // Deadline timer
+    uint64_t period;                // Microseconds
+    uint64_t next_deadline;         // Monotonic time of the next tick (microseconds)
+    uint64_t last_tick_time;        // Monotonic time of the previous tick (microseconds)
+    unsigned long tick_count;       // Number of ticks
+    unsigned long missed_count;     // Number of skipped deadlines
+    uint64_t period_total;          // Sum of the achieved periods (microseconds)
+    uint64_t period_min;            // Shortest achieved period (microseconds)
+    uint64_t period_max;            // Longest achieved period (microseconds)
+    uint64_t jitter_total;          // Sum of the tick latenesses past their deadlines (microseconds)
+    uint64_t jitter_max;            // Largest tick lateness past its deadline (microseconds)
+} PeriodicTimer;
+
+// Function declarations
+bool InitPeriodicTimer(PeriodicTimer* timer, uint64_t period);
+void FreePeriodicTimer(PeriodicTimer* timer);
+void StartPeriodicTimer(PeriodicTimer* timer);
+void WaitPeriodicTimer(PeriodicTimer* timer);
@@ -0,0 +1,339 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements portable threading and timing layer
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+
+#include "platform.h"
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Thread of execution
+struct Thread
+{
+    std::thread thread;
+};
+
+// Manual-reset or auto-reset event
+struct Event
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool manual_reset_flag;         // Stays signaled until cleared; otherwise a wait that returns clears it
+    bool signaled_flag;
+};
+
+// Mutual exclusion lock
+struct Mutex
+{
+    std::mutex mutex;
+};
+
+// Deadline timer
+struct Timer
+{
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE timer_handle;            // Waitable timer
+#else
+    int reserved;
+#endif
+};
+
+// Number of threads whose placement or priority could not be applied, e.g. for lack of privileges
+static std::atomic<unsigned long> thread_option_failures(0);
+
+// Purpose: This utility function applies the thread options and runs the thread function
+static void RunThread(ThreadOptions options, void (*function)(void* ptr), void* ptr)
+{
+    if (!ApplyThreadOptions(&options))
+        thread_option_failures.fetch_add(1, std::memory_order_relaxed);
+
+    function(ptr);
+}
+
+// Purpose: This function starts a thread of execution
+// Params: The thread function, its parameter and the placement and priority of the thread (may be NULL for defaults)
+// Returns: The thread or NULL if it could not be started
+struct Thread* StartThread(void (*function)(void* ptr), void* ptr, const ThreadOptions* options)
+{
+    ThreadOptions thread_options = { -1, PRIORITY_LEVEL_NORMAL };
+    struct Thread* thread = new (std::nothrow) Thread;
+
+    if (thread == NULL)
+        return NULL;
+
+    if (options != NULL)
+        thread_options = *options;
+
+    try
+    {
+        thread->thread = std::thread(RunThread, thread_options, function, ptr);
+    }
+    catch (const std::system_error&)
+    {
+        delete thread;
+        return NULL;
+    }
+
+    return thread;
+}
+
+// Purpose: This function waits for a thread to finish and releases it
+void JoinThread(struct Thread* thread)
+{
+    if (thread == NULL)
+        return;
+
+    if (thread->thread.joinable())
+        thread->thread.join();
+
+    delete thread;
+}
+
+// Purpose: This function pins the calling thread to a processor and sets its scheduling priority
+// Raising the priority above normal needs privileges: administrator rights for the time-critical priority on Windows
+// may be bypassed by the system, SCHED_FIFO on Linux needs CAP_SYS_NICE or a real-time priority limit
+// Params: Thread options
+// Returns: True if all options have been applied; false otherwise
+bool ApplyThreadOptions(const ThreadOptions* options)
+{
+    bool applied_flag = true;
+
+#if defined(_WIN32) || defined(_WIN64)
+    if ((options->cpu >= 0) && (options->cpu < (int)(sizeof(DWORD_PTR) * 8)))
+        applied_flag = (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << options->cpu) != 0);
+    else if (options->cpu >= 0)
+        applied_flag = false;
+
+    if (options->priority != PRIORITY_LEVEL_NORMAL)
+    {
+        int priority = (options->priority == PRIORITY_LEVEL_REALTIME) ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+
+        if (!SetThreadPriority(GetCurrentThread(), priority))
+            applied_flag = false;
+    }
+#elif defined(__linux__)
+    if ((options->cpu >= 0) && (options->cpu < CPU_SETSIZE))
+    {
+        cpu_set_t cpu_set;
+
+        CPU_ZERO(&cpu_set);
+        CPU_SET(options->cpu, &cpu_set);
+
+        applied_flag = (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0);
+    }
+    else if (options->cpu >= 0)
+    {
+        applied_flag = false;
+    }
+
+    if (options->priority != PRIORITY_LEVEL_NORMAL)
+    {
+        struct sched_param param;
+
+        // The highest priority is left to the kernel threads that must preempt everything else
+        param.sched_priority = (options->priority == PRIORITY_LEVEL_REALTIME) ?
+            (sched_get_priority_max(SCHED_FIFO) - 1) : sched_get_priority_min(SCHED_FIFO);
+
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+            applied_flag = false;
+    }
+#else
+    // Other systems run every thread with the default placement and priority
+    applied_flag = ((options->cpu < 0) && (options->priority == PRIORITY_LEVEL_NORMAL));
+#endif
+
+    return applied_flag;
+}
+
+// Purpose: This function retrieves the number of threads whose placement or priority could not be applied
+unsigned long GetThreadOptionFailures()
+{
+    return thread_option_failures.load(std::memory_order_relaxed);
+}
+
+// Purpose: This function creates a non-signaled event
+// Params: Whether the event stays signaled until it is cleared rather than until a wait returns
+// Returns: The event or NULL if it could not be allocated
+struct Event* NewEvent(bool manual_reset_flag)
+{
+    struct Event* event = new (std::nothrow) Event;
+
+    if (event != NULL)
+    {
+        event->manual_reset_flag = manual_reset_flag;
+        event->signaled_flag = false;
+    }
+
+    return event;
+}
+
+// Purpose: This function releases an event, no thread may be waiting for it
+void FreeEvent(struct Event* event)
+{
+    delete event;
+}
+
+// Purpose: This function signals an event, waking all waiting threads of a manual-reset event
+// or a single waiting thread of an auto-reset event
+void SignalEvent(struct Event* event)
+{
+    std::lock_guard<std::mutex> lock(event->mutex);
+
+    event->signaled_flag = true;
+
+    if (event->manual_reset_flag)
+        event->condition.notify_all();
+    else
+        event->condition.notify_one();
+}
+
+// Purpose: This function clears the signal of an event
+void ClearEvent(struct Event* event)
+{
+    std::lock_guard<std::mutex> lock(event->mutex);
+
+    event->signaled_flag = false;
+}
+
+// Purpose: This function waits for an event to be signaled
+// Params: The event and the timeout (milliseconds), WAIT_FOREVER never times out and 0 only checks the event
+// Returns: True if the event has been signaled; false if the wait has timed out
+bool WaitEvent(struct Event* event, unsigned long timeout)
+{
+    std::unique_lock<std::mutex> lock(event->mutex);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+    while (!event->signaled_flag)
+    {
+        if (timeout == WAIT_FOREVER)
+            event->condition.wait(lock);
+        else if (event->condition.wait_until(lock, deadline) == std::cv_status::timeout)
+            break;
+    }
+
+    bool signaled_flag = event->signaled_flag;
+
+    if (!event->manual_reset_flag)
+        event->signaled_flag = false;
+
+    return signaled_flag;
+}
+
+// Purpose: This function creates a mutex
+// Returns: The mutex or NULL if it could not be allocated
+struct Mutex* NewMutex()
+{
+    return new (std::nothrow) Mutex;
+}
+
+// Purpose: This function releases a mutex, which must not be locked
+void FreeMutex(struct Mutex* mutex)
+{
+    delete mutex;
+}
+
+// Purpose: This function locks a mutex, waiting for other threads to unlock it
+void LockMutex(struct Mutex* mutex)
+{
+    mutex->mutex.lock();
+}
+
+// Purpose: This function unlocks a mutex locked by the calling thread
+void UnlockMutex(struct Mutex* mutex)
+{
+    mutex->mutex.unlock();
+}
+
+// Purpose: This function creates a deadline timer
+// Returns: The timer or NULL if it could not be created
+struct Timer* NewTimer()
+{
+    struct Timer* timer = new (std::nothrow) Timer;
+
+    if (timer == NULL)
+        return NULL;
+
+#if defined(_WIN32) || defined(_WIN64)
+    timer->timer_handle = NULL;
+
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+    timer->timer_handle = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+
+    // Fall back to the standard resolution timer on systems without high-resolution timers
+    if (timer->timer_handle == NULL)
+        timer->timer_handle = CreateWaitableTimer(NULL, FALSE, NULL);
+
+    if (timer->timer_handle == NULL)
+    {
+        delete timer;
+        return NULL;
+    }
+#else
+    timer->reserved = 0;
+#endif
+
+    return timer;
+}
+
+// Purpose: This function releases a deadline timer
+void FreeTimer(struct Timer* timer)
+{
+    if (timer == NULL)
+        return;
+
+#if defined(_WIN32) || defined(_WIN64)
+    CloseHandle(timer->timer_handle);
+#endif
+
+    delete timer;
+}
+
+// Purpose: This function blocks until a deadline of the monotonic time
+// Params: The timer and the deadline (microseconds)
+void WaitTimer(struct Timer* timer, uint64_t deadline)
+{
+    uint64_t current_time = GetMonotonicTime();
+
+    if (current_time >= deadline)
+        return;
+
+#if defined(_WIN32) || defined(_WIN64)
+    // Relative due times are negative and expressed in 100 nanosecond intervals
+    LARGE_INTEGER due_time;
+    due_time.QuadPart = -(LONGLONG)((deadline - current_time) * 10);
+
+    if (SetWaitableTimer(timer->timer_handle, &due_time, 0, NULL, NULL, FALSE))
+        WaitForSingleObject(timer->timer_handle, INFINITE);
+#else
+    // The monotonic time is CLOCK_MONOTONIC, so the deadline is slept to directly without drift
+    (void)timer;
+
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline / ONE_SEC_IN_USEC);
+    ts.tv_nsec = (long)((deadline % ONE_SEC_IN_USEC) * 1000);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+#endif
+}
+
+// Purpose: This function suspends the calling thread
+// Params: Milliseconds to sleep
+void SleepMilliseconds(unsigned long milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
@@ -0,0 +1,54 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines portable threading and timing layer
+
+#pragma once
+
+#include "functions.h"
+
+// Threads, events and mutexes are built on the C++ standard library, so the engine runs on Windows and Linux alike.
+// They are opaque and allocated by this module, hence they can be held by structures allocated with malloc.
+// The platform-specific parts are confined to the hooks that pin a thread to a processor and raise its
+// scheduling priority, and to the deadline timer: a high-resolution waitable timer on Windows and
+// an absolute monotonic clock sleep on POSIX systems.
+
+#define WAIT_FOREVER 0xFFFFFFFFul   // Timeout of a wait that never times out
+
+// Scheduling priorities of a thread
+typedef enum {
+    PRIORITY_LEVEL_NORMAL,          // Default time-sharing scheduling
+    PRIORITY_LEVEL_HIGH,            // Highest time-sharing priority on Windows, lowest SCHED_FIFO priority on Linux
+    PRIORITY_LEVEL_REALTIME         // Time-critical priority on Windows, highest but one SCHED_FIFO priority on Linux
+} PRIORITY_LEVEL;
+
+// Placement and priority of a thread, applied by the thread itself before it runs its function
+typedef struct
+{
+    int cpu;                        // Zero-based processor to pin the thread to, -1 to let it run on any processor
+    PRIORITY_LEVEL priority;
+} ThreadOptions;
+
+struct Thread;
+struct Event;
+struct Mutex;
+struct Timer;
+
+// Function declarations
+struct Thread* StartThread(void (*function)(void* ptr), void* ptr, const ThreadOptions* options);
+void JoinThread(struct Thread* thread);
+bool ApplyThreadOptions(const ThreadOptions* options);
+unsigned long GetThreadOptionFailures();
+struct Event* NewEvent(bool manual_reset_flag);
+void FreeEvent(struct Event* event);
+void SignalEvent(struct Event* event);
+void ClearEvent(struct Event* event);
+bool WaitEvent(struct Event* event, unsigned long timeout);
+struct Mutex* NewMutex();
+void FreeMutex(struct Mutex* mutex);
+void LockMutex(struct Mutex* mutex);
+void UnlockMutex(struct Mutex* mutex);
+struct Timer* NewTimer();
+void FreeTimer(struct Timer* timer);
+void WaitTimer(struct Timer* timer, uint64_t deadline);
+void SleepMilliseconds(unsigned long milliseconds);
@@ -0,0 +1,145 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements simulated sensor pulse generator
+
+#include <math.h>
+
+#include "pulse_generator.h"
+
+// Purpose: This utility function advances the SplitMix64 generator, which expands a seed into generator states
+static uint64_t NextSplitMix(uint64_t* state)
+{
+    uint64_t value = (*state += 0x9E3779B97F4A7C15ull);
+
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+
+    return value ^ (value >> 31);
+}
+
+// Purpose: This utility function rotates the bits of a value to the left
+static inline uint64_t RotateLeft(uint64_t value, int count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+// Purpose: This function seeds random number generator
+// Params: A pointer to the generator and the seed
+void SeedRandomGenerator(RandomGenerator* random_generator, uint64_t seed)
+{
+    // SplitMix64 never produces an all-zero state, which xoshiro256** could not leave
+    for (unsigned int i = 0; i < 4; i++)
+        random_generator->state[i] = NextSplitMix(&seed);
+}
+
+// Purpose: This function draws the next random number
+// Returns: A uniformly distributed 64-bit random number
+uint64_t NextRandom(RandomGenerator* random_generator)
+{
+    uint64_t* state = random_generator->state;
+    uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = RotateLeft(state[3], 45);
+
+    return result;
+}
+
+// Purpose: This function draws a uniformly distributed random number in the range of [0, 1)
+double NextRandomDouble(RandomGenerator* random_generator)
+{
+    return (double)(NextRandom(random_generator) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Purpose: This function draws a uniformly distributed random integer in the range of [lower, upper]
+// The upper 32 bits are scaled to the range instead of taking a modulo, which is faster and, 
+// for ranges as narrow as pulse widths, biased by less than one part in a hundred million
+unsigned int NextRandomRange(RandomGenerator* random_generator, unsigned int lower, unsigned int upper)
+{
+    uint64_t range = (uint64_t)(upper - lower) + 1;
+
+    return lower + (unsigned int)(((NextRandom(random_generator) >> 32) * range) >> 32);
+}
+
+// Purpose: This utility function draws a normally distributed random number with zero mean and unit standard deviation
+// The Box-Muller transform produces two deviates at a time; the second one is kept for the next draw
+static double NextNormal(PulseGenerator* generator)
+{
+    if (generator->spare_flag)
+    {
+        generator->spare_flag = false;
+        return generator->spare;
+    }
+
+    double radius = sqrt(-2.0 * log(1.0 - NextRandomDouble(&generator->random_generator)));
+    double angle = 6.283185307179586 * NextRandomDouble(&generator->random_generator);
+
+    generator->spare = radius * sin(angle);
+    generator->spare_flag = true;
+
+    return radius * cos(angle);
+}
+
+// Purpose: This function initializes pulse generator
+// Params: A pointer to the generator, its configuration, which must outlive the generator, the seed 
+// and the stream number, which tells apart the generators sharing a seed (e.g. the channel identifier)
+void InitPulseGenerator(PulseGenerator* generator, const PulseGeneratorConfig* config, uint64_t seed, unsigned int stream)
+{
+    uint64_t stream_seed = seed + stream;
+
+    generator->config = config;
+    generator->count = 0;
+    generator->spare_flag = false;
+    generator->spare = 0.0;
+
+    SeedRandomGenerator(&generator->random_generator, NextSplitMix(&stream_seed));
+}
+
+// Purpose: This function simulates generation of electrical pulse signal width by a 
+// temperature measuring sensor that is converted to a corresponding temperature value
+// Params: A pointer to the generator
+// Returns: Electrical pulse width within the configured range (milliseconds)
+unsigned short GeneratePulseWidth(PulseGenerator* generator)
+{
+    const PulseGeneratorConfig* config = generator->config;
+    unsigned long index = generator->count++;
+    double width = config->setpoint;
+
+    switch (config->distribution)
+    {
+    case PULSE_DISTRIBUTION_UNIFORM:
+        return (unsigned short)NextRandomRange(&generator->random_generator, config->lower, config->upper);
+    case PULSE_DISTRIBUTION_NORMAL:
+        width = config->setpoint + config->spread * NextNormal(generator);
+        break;
+    case PULSE_DISTRIBUTION_STEP:
+        width = config->setpoint + config->spread * NextNormal(generator) + 
+            (((index / config->period) % 2 == 1) ? config->step : 0.0);
+        break;
+    case PULSE_DISTRIBUTION_RAMP:
+    {
+        // A triangle wave, which is its lowest at the start of every other period
+        double phase = (double)(index % (2 * config->period)) / config->period;
+        width = config->lower + (config->upper - config->lower) * ((phase < 1.0) ? phase : (2.0 - phase)) + 
+            config->spread * NextNormal(generator);
+        break;
+    }
+    }
+
+    // Round to the nearest width within the range
+    width += 0.5;
+
+    if (width < config->lower)
+        return config->lower;
+
+    if (width >= config->upper)
+        return config->upper;
+
+    return (unsigned short)width;
+}
@@ -0,0 +1,58 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines simulated sensor pulse generator
+
+#pragma once
+
+#include "functions.h"
+
+// The pulse generator simulates the pulse widths produced by a temperature sensor. Every generator owns 
+// a xoshiro256** random number generator, so channels generate their pulses without sharing any state and 
+// without a locked runtime library call. A generator seeded with the same seed produces the same pulse widths 
+// on every run, which makes load tests replayable; the seeds of the generators are derived from one seed 
+// with SplitMix64, so that the generators of different channels produce independent sequences.
+
+// Pulse width distributions
+typedef enum {
+    PULSE_DISTRIBUTION_UNIFORM,     // Uniform over the pulse width range
+    PULSE_DISTRIBUTION_NORMAL,      // Normal around the setpoint
+    PULSE_DISTRIBUTION_STEP,        // Normal around the setpoint, raised by the step height every other period
+    PULSE_DISTRIBUTION_RAMP         // Rising from the lower to the upper limit over a period and falling back over the next, with normal noise
+} PULSE_DISTRIBUTION;
+
+// Pulse generator configuration
+typedef struct
+{
+    PULSE_DISTRIBUTION distribution;
+    unsigned short lower;               // Smallest pulse width (milliseconds)
+    unsigned short upper;               // Largest pulse width (milliseconds)
+    double setpoint;                    // Mean pulse width of the normal and step distributions (milliseconds)
+    double spread;                      // Standard deviation of the normal, step and ramp distributions (milliseconds)
+    double step;                        // Step height of the step distribution (milliseconds)
+    unsigned int period;                // Number of pulses per step or ramp (positive)
+} PulseGeneratorConfig;
+
+// xoshiro256** random number generator
+typedef struct
+{
+    uint64_t state[4];
+} RandomGenerator;
+
+// Pulse generator
+typedef struct
+{
+    const PulseGeneratorConfig* config;
+    RandomGenerator random_generator;
+    unsigned long count;                // Number of generated pulses
+    bool spare_flag;                    // The spare normal deviate is valid
+    double spare;                       // Second normal deviate of the last Box-Muller transform
+} PulseGenerator;
+
+// Function declarations
+void SeedRandomGenerator(RandomGenerator* random_generator, uint64_t seed);
+uint64_t NextRandom(RandomGenerator* random_generator);
+double NextRandomDouble(RandomGenerator* random_generator);
+unsigned int NextRandomRange(RandomGenerator* random_generator, unsigned int lower, unsigned int upper);
+void InitPulseGenerator(PulseGenerator* generator, const PulseGeneratorConfig* config, uint64_t seed, unsigned int stream);
+unsigned short GeneratePulseWidth(PulseGenerator* generator);
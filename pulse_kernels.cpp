@@ -0,0 +1,134 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements batch pulse conversion kernels
+
+#include <limits.h>
+
+#include "pulse_kernels.h"
+
+#if defined(__AVX2__)
+#define PULSE_KERNEL_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PULSE_KERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+// Purpose: This utility function stores the alert flags of a group of pulses and counts them
+// Params: A comparison bit mask (bit k set if pulse k exceeds the threshold), 
+// a pointer to the alert flags (may be NULL) and the number of pulses in the group
+// Returns: The number of pulses exceeding the threshold
+static unsigned int StoreAlerts(unsigned int mask, bool* alerts, unsigned int count)
+{
+    unsigned int alert_count = 0;
+
+    for (unsigned int k = 0; k < count; k++)
+    {
+        bool alert = ((mask >> k) & 1) != 0;
+
+        if (alerts != NULL)
+            alerts[k] = alert;
+
+        alert_count += alert ? 1 : 0;
+    }
+
+    return alert_count;
+}
+
+// Purpose: This function converts pulse widths to temperatures and checks them against the warning threshold in one pass
+// Params: Pulse widths (milliseconds), temperatures to fill in (degrees Celsius, may be NULL), 
+// alert flags to fill in (may be NULL), number of pulses and the pulse width warning threshold (milliseconds)
+// Returns: The number of pulses whose width exceeds the warning threshold
+unsigned int ConvertPulseWidths(const unsigned short* widths, double* temps, bool* alerts, 
+    unsigned int count, unsigned short pulse_width_warning_threshold)
+{
+    unsigned int alert_count = 0;
+    unsigned int i = 0;
+
+#if defined(PULSE_KERNEL_AVX2)
+    const __m256d offset = _mm256_set1_pd(ThermostatCalibration::offset);
+    const __m256d scale = _mm256_set1_pd(ThermostatCalibration::scale);
+    const __m256i threshold = _mm256_set1_epi32(pulse_width_warning_threshold);
+
+    // Eight pulses per iteration
+    for (; (i + 8) <= count; i += 8)
+    {
+        __m256i width = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)&widths[i]));
+
+        if (temps != NULL)
+        {
+            __m256d lower = _mm256_cvtepi32_pd(_mm256_castsi256_si128(width));
+            __m256d upper = _mm256_cvtepi32_pd(_mm256_extracti128_si256(width, 1));
+
+            _mm256_storeu_pd(&temps[i], _mm256_mul_pd(_mm256_sub_pd(lower, offset), scale));
+            _mm256_storeu_pd(&temps[i + 4], _mm256_mul_pd(_mm256_sub_pd(upper, offset), scale));
+        }
+
+        unsigned int mask = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(width, threshold)));
+
+        alert_count += StoreAlerts(mask, (alerts != NULL) ? &alerts[i] : NULL, 8);
+    }
+#elif defined(PULSE_KERNEL_SSE2)
+    const __m128d offset = _mm_set1_pd(ThermostatCalibration::offset);
+    const __m128d scale = _mm_set1_pd(ThermostatCalibration::scale);
+    const __m128i threshold = _mm_set1_epi32(pulse_width_warning_threshold);
+    const __m128i zero = _mm_setzero_si128();
+
+    // Eight pulses per iteration
+    for (; (i + 8) <= count; i += 8)
+    {
+        __m128i width = _mm_loadu_si128((const __m128i*)&widths[i]);
+        __m128i lower = _mm_unpacklo_epi16(width, zero);
+        __m128i upper = _mm_unpackhi_epi16(width, zero);
+
+        if (temps != NULL)
+        {
+            _mm_storeu_pd(&temps[i], _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(lower), offset), scale));
+            _mm_storeu_pd(&temps[i + 2], _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(lower, 0xEE)), offset), scale));
+            _mm_storeu_pd(&temps[i + 4], _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(upper), offset), scale));
+            _mm_storeu_pd(&temps[i + 6], _mm_mul_pd(_mm_sub_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(upper, 0xEE)), offset), scale));
+        }
+
+        unsigned int mask = (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lower, threshold))) | 
+            ((unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(upper, threshold))) << 4);
+
+        alert_count += StoreAlerts(mask, (alerts != NULL) ? &alerts[i] : NULL, 8);
+    }
+#endif
+
+    // Scalar fallback and the remaining pulses
+    for (; i < count; i++)
+    {
+        if (temps != NULL)
+            temps[i] = ConvertPulseWidthToTemp(widths[i]);
+
+        bool alert = (widths[i] > pulse_width_warning_threshold);
+
+        if (alerts != NULL)
+            alerts[i] = alert;
+
+        alert_count += alert ? 1 : 0;
+    }
+
+    return alert_count;
+}
+
+// Purpose: This function converts pulse widths to temperatures
+// Params: Pulse widths (milliseconds), temperatures to fill in (degrees Celsius) and number of pulses
+void ConvertPulseWidthsToTemps(const unsigned short* widths, double* temps, unsigned int count)
+{
+    ConvertPulseWidths(widths, temps, NULL, count, USHRT_MAX);
+}
+
+// Purpose: This function retrieves the name of the instruction set the kernels have been compiled for
+const char* GetPulseKernelName()
+{
+#if defined(PULSE_KERNEL_AVX2)
+    return "AVX2";
+#elif defined(PULSE_KERNEL_SSE2)
+    return "SSE2";
+#else
+    return "Scalar";
+#endif
+}
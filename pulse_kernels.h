@@ -0,0 +1,23 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines batch pulse conversion kernels
+
+#pragma once
+
+#include "functions.h"
+
+// Converting a pulse width to a temperature is an affine transform, and checking it against 
+// the warning threshold is a single comparison, so both vectorize trivially when applied to 
+// many pulses at once. The kernels below process an array of pulse widths in one pass and are 
+// used wherever many pulses are handled together: the channel engine when it drains a queue and 
+// the log rendering of window dumps.
+// The vector width is chosen at compile time: AVX2 when the compiler targets it (/arch:AVX2 or -mavx2), 
+// SSE2 on every x64 target, and a scalar loop elsewhere. All variants produce results identical to 
+// ConvertPulseWidthToTemp, since subtraction and multiplication of doubles are exact in every lane.
+
+// Function declarations
+unsigned int ConvertPulseWidths(const unsigned short* widths, double* temps, bool* alerts, 
+    unsigned int count, unsigned short pulse_width_warning_threshold);
+void ConvertPulseWidthsToTemps(const unsigned short* widths, double* temps, unsigned int count);
+const char* GetPulseKernelName();
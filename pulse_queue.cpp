@@ -0,0 +1,84 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements lock-free single-producer/single-consumer pulse queue
+
+#include "pulse_queue.h"
+
+// Purpose: This function initializes pulse queue
+// Params: A pointer to the queue and the requested capacity, which is rounded up to a power of two
+// Returns: True if the queue storage has been allocated; false otherwise
+bool InitPulseQueue(PulseQueue* queue, unsigned int capacity)
+{
+    unsigned int size = 1;
+
+    while (size < capacity)
+        size <<= 1;
+
+    queue->pulses = (Pulse*)malloc(sizeof(Pulse) * size);
+    queue->mask = size - 1;
+    queue->head.store(0, std::memory_order_relaxed);
+    queue->tail.store(0, std::memory_order_relaxed);
+    queue->dropped_count.store(0, std::memory_order_relaxed);
+
+    return (queue->pulses != NULL);
+}
+
+// Purpose: This function releases pulse queue storage
+void FreePulseQueue(PulseQueue* queue)
+{
+    free(queue->pulses);
+    queue->pulses = NULL;
+}
+
+// Purpose: This function appends a pulse to the queue. It must be called by the producer thread only.
+// Returns: True if the pulse has been queued; false if the queue is full and the pulse has been dropped
+bool EnqueuePulse(PulseQueue* queue, Pulse pulse)
+{
+    unsigned int head = queue->head.load(std::memory_order_relaxed);
+    unsigned int tail = queue->tail.load(std::memory_order_acquire);
+
+    if ((head - tail) > queue->mask)
+    {
+        queue->dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    queue->pulses[head & queue->mask] = pulse;
+
+    // Publish the pulse to the consumer
+    queue->head.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Purpose: This function removes the oldest pulse from the queue. It must be called by the consumer thread only.
+// Returns: True if a pulse has been retrieved; false if the queue is empty
+bool DequeuePulse(PulseQueue* queue, Pulse* pulse)
+{
+    unsigned int tail = queue->tail.load(std::memory_order_relaxed);
+    unsigned int head = queue->head.load(std::memory_order_acquire);
+
+    if (tail == head)
+        return false;
+
+    *pulse = queue->pulses[tail & queue->mask];
+
+    // Hand the slot back to the producer
+    queue->tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+// Purpose: This function checks whether the queue holds no pulses
+// Returns: True if there are no pulses waiting to be processed; false otherwise
+bool IsPulseQueueEmpty(const PulseQueue* queue)
+{
+    return (queue->tail.load(std::memory_order_acquire) == queue->head.load(std::memory_order_acquire));
+}
+
+// Purpose: This function retrieves the number of pulses dropped because the queue was full
+unsigned long GetDroppedPulses(const PulseQueue* queue)
+{
+    return queue->dropped_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,36 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines lock-free single-producer/single-consumer pulse queue
+
+#pragma once
+
+#include <atomic>
+
+#include "functions.h"
+
+#define CACHE_LINE_SIZE 64
+
+// The pulse queue delivers every pulse from the pulse generating thread to the processing thread.
+// It is a fixed-capacity ring buffer where only the producer writes the head index and only the 
+// consumer writes the tail index, so neither side ever takes a lock. The indices are kept on separate 
+// cache lines to keep the two threads from invalidating each other's cache line on every pulse.
+// If the consumer falls behind and the queue is full, the new pulse is dropped and counted.
+
+// Lock-free single-producer/single-consumer pulse queue
+typedef struct
+{
+    Pulse* pulses;
+    unsigned int mask;                                          // Capacity minus one (capacity is a power of two)
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned int> head;    // Next slot to write, owned by the producer
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned int> tail;    // Next slot to read, owned by the consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned long> dropped_count;
+} PulseQueue;
+
+// Function declarations
+bool InitPulseQueue(PulseQueue* queue, unsigned int capacity);
+void FreePulseQueue(PulseQueue* queue);
+bool EnqueuePulse(PulseQueue* queue, Pulse pulse);
+bool DequeuePulse(PulseQueue* queue, Pulse* pulse);
+bool IsPulseQueueEmpty(const PulseQueue* queue);
+unsigned long GetDroppedPulses(const PulseQueue* queue);
@@ -0,0 +1,93 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements time-ordered pulse ring buffer
+
+#include "pulse_ring.h"
+
+// Purpose: This function initializes pulse ring buffer
+// Params: A pointer to the ring and maximum number of pulses in the ring
+// Returns: True if the ring storage has been allocated; false otherwise
+bool InitPulseRing(PulseRing* ring, unsigned int capacity)
+{
+    ring->widths = (capacity > 0) ? (unsigned short*)malloc(sizeof(unsigned short) * capacity) : NULL;
+    ring->timestamps = (capacity > 0) ? (uint64_t*)malloc(sizeof(uint64_t) * capacity) : NULL;
+    ring->indices = (capacity > 0) ? (unsigned int*)malloc(sizeof(unsigned int) * capacity) : NULL;
+    ring->capacity = capacity;
+    ring->oldest = 0;
+    ring->count = 0;
+
+    if ((ring->widths == NULL) || (ring->timestamps == NULL) || (ring->indices == NULL))
+    {
+        FreePulseRing(ring);
+        return false;
+    }
+
+    return true;
+}
+
+// Purpose: This function releases pulse ring buffer storage
+void FreePulseRing(PulseRing* ring)
+{
+    free(ring->widths);
+    free(ring->timestamps);
+    free(ring->indices);
+
+    ring->widths = NULL;
+    ring->timestamps = NULL;
+    ring->indices = NULL;
+    ring->capacity = 0;
+    ring->oldest = 0;
+    ring->count = 0;
+}
+
+// Purpose: This function checks whether the ring has no room for a new pulse
+bool IsPulseRingFull(const PulseRing* ring)
+{
+    return (ring->count == ring->capacity);
+}
+
+// Purpose: This function appends a new pulse at the head of the ring
+// The caller must make room for the pulse if the ring is full and set its companion index
+// Params: A pointer to the ring and a pulse with the youngest timestamp
+// Returns: The slot of the new pulse within the ring
+unsigned int PushPulse(PulseRing* ring, Pulse pulse)
+{
+    unsigned int slot = ring->oldest + ring->count;
+
+    if (slot >= ring->capacity)
+        slot -= ring->capacity;
+
+    ring->widths[slot] = pulse.width;
+    ring->timestamps[slot] = pulse.timestamp;
+    ring->indices[slot] = 0;
+    ring->count++;
+
+    return slot;
+}
+
+// Purpose: This function checks whether the oldest pulse of the ring holds stale data
+// Stale data has its timestamp value smaller by more than the window length than the youngest timestamp
+// Returns: True if the ring is not empty and the oldest pulse is stale; false otherwise
+bool IsOldestPulseStale(const PulseRing* ring, uint64_t timestamp, uint64_t window_length)
+{
+    return (ring->count > 0) && ((ring->timestamps[ring->oldest] + window_length) < timestamp);
+}
+
+// Purpose: This function removes the oldest pulse of the ring
+void PopOldestPulse(PulseRing* ring)
+{
+    if (ring->count > 0)
+    {
+        ring->oldest = (ring->oldest + 1 == ring->capacity) ? 0 : ring->oldest + 1;
+        ring->count--;
+    }
+}
+
+// Purpose: This function retrieves the slot of the pulse with the given age, where age 0 is the oldest pulse
+unsigned int GetSlotByAge(const PulseRing* ring, unsigned int age)
+{
+    unsigned int slot = ring->oldest + age;
+
+    return (slot >= ring->capacity) ? slot - ring->capacity : slot;
+}
@@ -0,0 +1,40 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines time-ordered pulse ring buffer
+
+#pragma once
+
+#include "functions.h"
+
+// Pulses arrive in timestamp order, hence a fixed-capacity circular buffer indexed by arrival 
+// keeps them sorted by time for free. The oldest pulse is always at the tail of the ring, 
+// so eviction of stale pulses pops from the tail and touches exactly the expired entries.
+// Every pulse carries a companion index that the median structure uses to locate the pulse 
+// within itself (e.g. heap position or histogram bin), so the evicted pulse is removed there 
+// without a search.
+// The ring is laid out as a structure of arrays: pulse widths, timestamps and companion 
+// indices are kept in separate contiguous arrays addressed by the same slot. Median calculation 
+// only touches the widths, eviction only touches the timestamps, so every cache line brought in 
+// holds nothing but the field being scanned. Temperature is not stored; it is derived from the 
+// pulse width on demand with ConvertPulseWidthToTemp.
+
+// Time-ordered pulse ring buffer
+typedef struct
+{
+    unsigned short* widths;     // Pulse widths (milliseconds)
+    uint64_t* timestamps;       // Pulse timestamps (microseconds)
+    unsigned int* indices;      // Companion indices into the median structure
+    unsigned int capacity;      // Maximum number of pulses in the ring
+    unsigned int oldest;        // Slot of the oldest pulse (tail)
+    unsigned int count;         // Number of pulses in the ring
+} PulseRing;
+
+// Function declarations
+bool InitPulseRing(PulseRing* ring, unsigned int capacity);
+void FreePulseRing(PulseRing* ring);
+bool IsPulseRingFull(const PulseRing* ring);
+unsigned int PushPulse(PulseRing* ring, Pulse pulse);
+bool IsOldestPulseStale(const PulseRing* ring, uint64_t timestamp, uint64_t window_length);
+void PopOldestPulse(PulseRing* ring);
+unsigned int GetSlotByAge(const PulseRing* ring, unsigned int age);
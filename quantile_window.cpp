@@ -0,0 +1,240 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements approximate quantile window
+
+#include "quantile_window.h"
+
+static const double quantile_probabilities[QUANTILE_COUNT] = { 0.5, 0.9, 0.99 };
+
+// Purpose: This utility function resets an estimator to track the given quantile
+static void InitP2Estimator(P2Estimator* estimator, double p)
+{
+    estimator->p = p;
+    estimator->count = 0;
+
+    for (unsigned int i = 0; i < P2_MARKER_COUNT; i++)
+    {
+        estimator->heights[i] = 0;
+        estimator->positions[i] = i;
+    }
+
+    estimator->desired[0] = 0;
+    estimator->desired[1] = 2 * p;
+    estimator->desired[2] = 4 * p;
+    estimator->desired[3] = 2 + 2 * p;
+    estimator->desired[4] = 4;
+
+    estimator->increments[0] = 0;
+    estimator->increments[1] = p / 2;
+    estimator->increments[2] = p;
+    estimator->increments[3] = (1 + p) / 2;
+    estimator->increments[4] = 1;
+}
+
+// Purpose: This utility function calculates the piecewise-parabolic prediction of a marker height
+static double PredictParabolic(const P2Estimator* estimator, unsigned int i, int d)
+{
+    const double* q = estimator->heights;
+    const int* n = estimator->positions;
+
+    return q[i] + (double)d / (n[i + 1] - n[i - 1]) * 
+        ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) + 
+        (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+}
+
+// Purpose: This utility function adds an observation to an estimator
+static void AddP2Sample(P2Estimator* estimator, double x)
+{
+    double* q = estimator->heights;
+    int* n = estimator->positions;
+
+    // The first observations are kept sorted as the initial marker heights
+    if (estimator->count < P2_MARKER_COUNT)
+    {
+        unsigned int i = estimator->count++;
+
+        for (; (i > 0) && (q[i - 1] > x); i--)
+            q[i] = q[i - 1];
+
+        q[i] = x;
+        return;
+    }
+
+    // Locate the cell of the observation, extending the extreme markers if needed
+    unsigned int k;
+
+    if (x < q[0])
+    {
+        q[0] = x;
+        k = 0;
+    }
+    else if (x >= q[P2_MARKER_COUNT - 1])
+    {
+        q[P2_MARKER_COUNT - 1] = x;
+        k = P2_MARKER_COUNT - 2;
+    }
+    else
+    {
+        for (k = 0; x >= q[k + 1]; k++);
+    }
+
+    for (unsigned int i = k + 1; i < P2_MARKER_COUNT; i++)
+        n[i]++;
+
+    for (unsigned int i = 0; i < P2_MARKER_COUNT; i++)
+        estimator->desired[i] += estimator->increments[i];
+
+    // Move the middle markers towards their desired positions by one step at most
+    for (unsigned int i = 1; i < (P2_MARKER_COUNT - 1); i++)
+    {
+        double delta = estimator->desired[i] - n[i];
+
+        if (((delta >= 1) && ((n[i + 1] - n[i]) > 1)) || ((delta <= -1) && ((n[i - 1] - n[i]) < -1)))
+        {
+            int d = (delta >= 0) ? 1 : -1;
+            double height = PredictParabolic(estimator, i, d);
+
+            // Fall back to linear prediction if the parabolic one breaks the marker order
+            if ((q[i - 1] < height) && (height < q[i + 1]))
+                q[i] = height;
+            else
+                q[i] = q[i] + d * (q[i + d] - q[i]) / (n[i + d] - n[i]);
+
+            n[i] += d;
+        }
+    }
+
+    estimator->count++;
+}
+
+// Purpose: This utility function retrieves the estimate of an estimator
+// Returns: The quantile estimate or 0 if no observation has been added
+static double GetP2Estimate(const P2Estimator* estimator)
+{
+    if (estimator->count == 0)
+        return 0;
+
+    // Nearest rank among the first observations
+    if (estimator->count <= P2_MARKER_COUNT)
+        return estimator->heights[(unsigned int)(estimator->p * (estimator->count - 1) + 0.5)];
+
+    return estimator->heights[2];
+}
+
+// Purpose: This utility function restarts a set of estimators
+static void ResetEstimatorSet(QuantileWindow* quantile_window, unsigned int set)
+{
+    for (unsigned int quantile = 0; quantile < QUANTILE_COUNT; quantile++)
+        InitP2Estimator(&quantile_window->estimators[set][quantile], quantile_probabilities[quantile]);
+}
+
+// Purpose: This utility function retrieves the set of estimators that covers the longest period
+static unsigned int GetReportedSet(const QuantileWindow* quantile_window)
+{
+    unsigned int older = (quantile_window->start_timestamps[0] <= quantile_window->start_timestamps[1]) ? 0 : 1;
+
+    // Right after a restart the older set may not have seen a pulse yet
+    return (quantile_window->estimators[older][QUANTILE_P50].count > 0) ? older : 1 - older;
+}
+
+// Purpose: This function initializes approximate quantile window
+// Params: A pointer to the window and window length (microseconds)
+void InitQuantileWindow(QuantileWindow* quantile_window, uint64_t window_length)
+{
+    ResetEstimatorSet(quantile_window, 0);
+    ResetEstimatorSet(quantile_window, 1);
+
+    quantile_window->start_timestamps[0] = 0;
+    quantile_window->start_timestamps[1] = 0;
+    quantile_window->started_flag = false;
+    quantile_window->window_length = (window_length > 1) ? window_length : 2;
+}
+
+// Purpose: This function restarts the sets of estimators whose period is over
+// Params: A pointer to the window and the youngest timestamp
+// Returns: The number of sets restarted
+unsigned int EvictStaleQuantilePulses(QuantileWindow* quantile_window, uint64_t timestamp)
+{
+    unsigned int restarted = 0;
+
+    if (!quantile_window->started_flag)
+        return 0;
+
+    for (unsigned int set = 0; set < 2; set++)
+    {
+        uint64_t start_timestamp = quantile_window->start_timestamps[set];
+
+        if ((timestamp >= start_timestamp) && ((timestamp - start_timestamp) >= quantile_window->window_length))
+        {
+            // Skip whole periods without pulses
+            quantile_window->start_timestamps[set] += 
+                ((timestamp - start_timestamp) / quantile_window->window_length) * quantile_window->window_length;
+
+            ResetEstimatorSet(quantile_window, set);
+            restarted++;
+        }
+    }
+
+    return restarted;
+}
+
+// Purpose: This function adds a new pulse to the window
+// Params: A pointer to the window and a pulse with the youngest timestamp
+void AddQuantilePulse(QuantileWindow* quantile_window, Pulse pulse)
+{
+    // The second set starts half a window after the first pulse
+    if (!quantile_window->started_flag)
+    {
+        quantile_window->start_timestamps[0] = pulse.timestamp;
+        quantile_window->start_timestamps[1] = pulse.timestamp + (quantile_window->window_length / 2);
+        quantile_window->started_flag = true;
+    }
+
+    for (unsigned int set = 0; set < 2; set++)
+    {
+        if (pulse.timestamp < quantile_window->start_timestamps[set])
+            continue;
+
+        for (unsigned int quantile = 0; quantile < QUANTILE_COUNT; quantile++)
+            AddP2Sample(&quantile_window->estimators[set][quantile], pulse.width);
+    }
+}
+
+// Purpose: This function retrieves an approximate quantile of the pulse widths of the window
+// The quantile is doubled like the medians of the exact modes
+// Returns: Twice the quantile pulse width or 0 if the window is empty
+unsigned int GetQuantile(const QuantileWindow* quantile_window, QUANTILE quantile)
+{
+    const P2Estimator* estimator = &quantile_window->estimators[GetReportedSet(quantile_window)][quantile];
+
+    return (unsigned int)(2.0 * GetP2Estimate(estimator) + 0.5);
+}
+
+// Purpose: This function retrieves the probability of a reported quantile, e.g. 0.9 for QUANTILE_P90
+double GetQuantileProbability(QUANTILE quantile)
+{
+    return quantile_probabilities[quantile];
+}
+
+// Purpose: This function retrieves the number of pulses summarized by the reported quantiles
+unsigned long GetQuantileCount(const QuantileWindow* quantile_window)
+{
+    return quantile_window->estimators[GetReportedSet(quantile_window)][QUANTILE_P50].count;
+}
+
+// Purpose: This function prints the reported quantiles of the window
+void PrintQuantileWindow(const QuantileWindow* quantile_window, FILE* fptr)
+{
+#if defined(PRINTF_MODE) && (LOG_MIN_LEVEL <= LOG_LEVEL_TRACE)
+    if (!LOG_ENABLED(LOG_LEVEL_TRACE))
+        return;
+
+    PrintStr("P50/P90/P99:", fptr);
+
+    for (unsigned int quantile = 0; quantile < QUANTILE_COUNT; quantile++)
+        PrintTemp(ConvertDoubledPulseWidthToTemp(GetQuantile(quantile_window, (QUANTILE)quantile)), fptr);
+
+    PrintStr("\n", fptr);
+#endif
+}
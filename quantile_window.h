@@ -0,0 +1,55 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines approximate quantile window
+
+#pragma once
+
+#include "functions.h"
+
+// Long trend windows (minutes) hold far too many pulses to store every one of them, hence the 
+// approximate quantile window summarizes the pulses with P-square estimators (Jain and Chlamtac), 
+// which track a single quantile with five markers each, in constant memory and constant time per pulse.
+// A P-square estimator cannot forget a pulse, so the window is approximated by two sets of estimators 
+// that restart every window length, staggered by half a window. The set that restarted earlier covers 
+// between one half and one full window length of the most recent pulses and is the one reported.
+
+#define P2_MARKER_COUNT 5
+
+// Reported quantiles
+typedef enum
+{
+    QUANTILE_P50,               // Median
+    QUANTILE_P90,
+    QUANTILE_P99,
+    QUANTILE_COUNT
+} QUANTILE;
+
+// P-square single quantile estimator
+typedef struct
+{
+    double p;                               // Quantile to estimate, (0, 1)
+    double heights[P2_MARKER_COUNT];        // Marker heights (pulse widths)
+    int positions[P2_MARKER_COUNT];         // Actual marker positions
+    double desired[P2_MARKER_COUNT];        // Desired marker positions
+    double increments[P2_MARKER_COUNT];     // Desired position increments per observation
+    unsigned long count;                    // Number of observations
+} P2Estimator;
+
+// Approximate quantile window
+typedef struct
+{
+    P2Estimator estimators[2][QUANTILE_COUNT];  // Two staggered sets of estimators
+    uint64_t start_timestamps[2];               // Start of the current period of every set (microseconds)
+    bool started_flag;                          // Set once the first pulse has been added
+    uint64_t window_length;                     // Microseconds
+} QuantileWindow;
+
+// Function declarations
+void InitQuantileWindow(QuantileWindow* quantile_window, uint64_t window_length);
+unsigned int EvictStaleQuantilePulses(QuantileWindow* quantile_window, uint64_t timestamp);
+void AddQuantilePulse(QuantileWindow* quantile_window, Pulse pulse);
+double GetQuantileProbability(QUANTILE quantile);
+unsigned int GetQuantile(const QuantileWindow* quantile_window, QUANTILE quantile);
+unsigned long GetQuantileCount(const QuantileWindow* quantile_window);
+void PrintQuantileWindow(const QuantileWindow* quantile_window, FILE* fptr);
@@ -0,0 +1,254 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements deterministic replay of recorded pulses
+
+#include "replay.h"
+#include "binary_log.h"
+
+// Purpose: This utility function reads the next new pulse record of a binary log
+// Returns: True if a record has been read; false at the end of the file
+static bool ReadNewPulseRecord(FILE* fptr, BinaryLogRecord* record)
+{
+    while (ReadBinaryLogRecord(fptr, record))
+    {
+        if (record->type == RECORD_NEW_PULSE)
+            return true;
+    }
+
+    return false;
+}
+
+// Purpose: This function opens a recorded log file for replay
+// A file that starts with the binary log header is read as a binary log; any other file is read as a text log
+// Params: A pointer to the replay source, the log file name and the inter-arrival time of the pulses 
+// of a text log (milliseconds)
+// Returns: True if the file has been opened; false otherwise
+bool OpenReplaySource(ReplaySource* source, const char* file_name, unsigned long pulse_interval)
+{
+    BinaryLogHeader header;
+
+    source->fptr = fopen(file_name, "rb");
+    source->binary_flag = false;
+    source->start_time = 0;
+    source->pulse_interval = pulse_interval;
+    source->timestamps = NULL;
+    source->timestamp_count = 0;
+    source->skipped_count = 0;
+    source->line[0] = '\0';
+    source->line_ptr = source->line;
+
+    if (source->fptr == NULL)
+        return false;
+
+    if (ReadBinaryLogHeader(source->fptr, &header))
+    {
+        source->binary_flag = true;
+
+        // The replay starts when the generator has started producing the first pulse
+        long records_offset = ftell(source->fptr);
+        BinaryLogRecord record;
+
+        if (ReadNewPulseRecord(source->fptr, &record))
+        {
+            uint64_t delay = (uint64_t)record.width * ONE_MSEC_IN_USEC;
+            source->start_time = (record.timestamp > delay) ? (record.timestamp - delay) : 0;
+        }
+
+        fseek(source->fptr, records_offset, SEEK_SET);
+    }
+    else
+    {
+        rewind(source->fptr);
+    }
+
+    return true;
+}
+
+// Purpose: This function closes replay source
+void CloseReplaySource(ReplaySource* source)
+{
+    if (source->fptr != NULL)
+        fclose(source->fptr);
+
+    free(source->timestamps);
+
+    source->fptr = NULL;
+    source->timestamps = NULL;
+    source->timestamp_count = 0;
+}
+
+// Purpose: This utility function parses the channel identifier that starts the line in front of a text record
+// Params: The start of the line and the record within it
+// Returns: The channel identifier, or 0 if the record is not preceded by one
+static unsigned int ParseRecordChannel(const char* line, const char* record_ptr)
+{
+    const char* ptr = record_ptr;
+
+    // The identifier is bracketed and followed by a space, e.g. "[2] New:"
+    if (((ptr - line) < 4) || (ptr[-1] != ' ') || (ptr[-2] != ']'))
+        return 0;
+
+    ptr -= 2;
+
+    while ((ptr > line) && (ptr[-1] >= '0') && (ptr[-1] <= '9'))
+        ptr--;
+
+    if ((ptr == (record_ptr - 2)) || (ptr == line) || (ptr[-1] != '['))
+        return 0;
+
+    return (unsigned int)strtoul(ptr, NULL, 10);
+}
+
+// Purpose: This utility function retrieves the arrival time of the previous pulse of a channel of a text log
+// Returns: A pointer to the arrival time, or NULL if it could not be allocated
+static uint64_t* GetChannelTimestamp(ReplaySource* source, unsigned int channel_id)
+{
+    if (channel_id >= source->timestamp_count)
+    {
+        unsigned int count = channel_id + 1;
+        uint64_t* timestamps = (uint64_t*)realloc(source->timestamps, sizeof(uint64_t) * count);
+
+        if (timestamps == NULL)
+            return NULL;
+
+        // Every channel starts producing its first pulse at the start
+        for (unsigned int id = source->timestamp_count; id < count; id++)
+            timestamps[id] = source->start_time;
+
+        source->timestamps = timestamps;
+        source->timestamp_count = count;
+    }
+
+    return &source->timestamps[channel_id];
+}
+
+// Purpose: This function reads the next recorded pulse
+// The "New:" records of a text log may share a line with other records written by another thread, 
+// so every line is searched for all the records it holds
+// Params: A pointer to the replay source, a pointer to the pulse and a pointer to the channel identifier of the pulse
+// Returns: True if a pulse has been read; false at the end of the file
+bool ReadReplayPulse(ReplaySource* source, Pulse* pulse, unsigned int* channel_id)
+{
+    if (source->binary_flag)
+    {
+        BinaryLogRecord record;
+
+        if (!ReadNewPulseRecord(source->fptr, &record))
+            return false;
+
+        pulse->valid = true;
+        pulse->width = record.width;
+        pulse->timestamp = record.timestamp;
+        *channel_id = record.channel;
+
+        return true;
+    }
+
+    while (true)
+    {
+        const char* record_ptr = strstr(source->line_ptr, "New:");
+
+        if (record_ptr == NULL)
+        {
+            if (fgets(source->line, sizeof(source->line), source->fptr) == NULL)
+                return false;
+
+            source->line_ptr = source->line;
+            continue;
+        }
+
+        char* end_ptr = NULL;
+        double temp = strtod(record_ptr + strlen("New:"), &end_ptr);
+
+        source->line_ptr = end_ptr;
+
+        if (end_ptr == record_ptr + strlen("New:"))
+            continue;
+
+        // Recover the pulse width from its temperature, which has been rounded to a tenth of a degree
+        double width = ThermostatCalibration::ConvertToPulseWidth(temp) + 0.5;
+
+        if (width < pulse_width_lower_limit)
+            width = pulse_width_lower_limit;
+
+        if (width > pulse_width_upper_limit)
+            width = pulse_width_upper_limit;
+
+        *channel_id = ParseRecordChannel(source->line, record_ptr);
+
+        uint64_t* timestamp = GetChannelTimestamp(source, *channel_id);
+
+        if (timestamp == NULL)
+            return false;
+
+        pulse->valid = true;
+        pulse->width = (unsigned short)width;
+
+        // The first pulse of a channel arrives its width after the start; every next one also waits for the inter-arrival time
+        *timestamp += (uint64_t)(pulse->width + ((*timestamp > source->start_time) ? source->pulse_interval : 0)) 
+            * ONE_MSEC_IN_USEC;
+        pulse->timestamp = *timestamp;
+
+        return true;
+    }
+}
+
+// Purpose: This function replays every recorded pulse to its channel of a channel pool in virtual time
+// The warnings of the pool advance at every warning period deadline passed before a pulse arrives
+// Params: A pointer to the channel pool, whose worker threads must not be running, a pointer to the replay source 
+// and the warning period (microseconds)
+// The virtual time must have been set to the start time of the source before the channel pool was initialized
+// Returns: The number of replayed pulses
+unsigned long ReplayPulses(struct ChannelPool* pool, ReplaySource* source, uint64_t warning_period)
+{
+    uint64_t current_time = source->start_time;
+    uint64_t next_tick_time = source->start_time + warning_period;
+    unsigned long count = 0;
+    unsigned int channel_id = 0;
+    Pulse pulse;
+
+    while (ReadReplayPulse(source, &pulse, &channel_id))
+    {
+        if (channel_id >= pool->channel_count)
+        {
+            source->skipped_count++;
+            continue;
+        }
+
+        Channel* channel = &pool->channels[channel_id];
+
+        // Virtual time must never step backwards
+        if (pulse.timestamp < current_time)
+            pulse.timestamp = current_time;
+
+        while (next_tick_time <= pulse.timestamp)
+        {
+            SetVirtualTime(next_tick_time);
+            TickChannelPoolWarnings(pool);
+            next_tick_time += warning_period;
+        }
+
+        current_time = pulse.timestamp;
+        SetVirtualTime(current_time);
+        SetLogChannel((int)channel_id);
+
+        if (LOG_ENABLED(LOG_LEVEL_PULSE))
+        {
+            PrintStr("New:   ", pool->fptr);
+            PrintTemp(ConvertDoubledPulseWidthToTemp(2u * pulse.width), pool->fptr);
+            PrintStr("\n", pool->fptr);
+        }
+
+        LogBinaryRecord(RECORD_NEW_PULSE, pulse.width, 0, pulse.timestamp, pool->fptr);
+        SetLogChannel(LOG_CHANNEL_NONE);
+
+        // The pulse takes the path of a submitted pulse through the queue and the batch processing
+        if (EnqueuePulse(&channel->queue, pulse))
+            ProcessChannelPulses(channel, pool->fptr);
+
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,41 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines deterministic replay of recorded pulses
+
+#pragma once
+
+#include "functions.h"
+#include "channel_pool.h"
+
+// The replay feeds the pulses recorded in a log file through the full median, alert and state machine 
+// pipeline of a channel pool, instead of generating them in real time. The pipeline runs in virtual time: 
+// the clock is set to the arrival time of every pulse before it is processed and to every warning period 
+// deadline in between, so a replay takes as long as the processing itself and produces the same output 
+// on every run. The pulses are processed by the replaying thread; the worker threads are not started.
+// Binary logs carry the arrival time of every pulse. Text logs carry only the temperature of the "New:" records, 
+// so the pulse width is recovered from it and the arrival time is rebuilt the way the pulse generator produces it: 
+// a pulse arrives its width after the previous pulse of its channel plus the inter-arrival time the log was written with.
+// Every pulse is replayed to the channel it was recorded for: binary records carry the channel identifier and 
+// text lines start with it; text lines without one, written before channels were recorded, belong to channel 0.
+// Pulses of channels the channel pool does not have are skipped and counted.
+
+// Replay source
+typedef struct
+{
+    FILE* fptr;
+    bool binary_flag;                   // Binary log file; text log file otherwise
+    uint64_t start_time;                // Virtual time at which the replay starts (microseconds)
+    unsigned long pulse_interval;       // Time between a pulse of a text log and the next signal width generation (milliseconds)
+    uint64_t* timestamps;               // Arrival time of the previous pulse of every channel of a text log (microseconds)
+    unsigned int timestamp_count;       // Number of channels with arrival times
+    unsigned long skipped_count;        // Number of pulses of channels the channel pool does not have
+    char line[4096];                    // Current line of a text log
+    const char* line_ptr;               // Where to continue looking for pulses in the current line
+} ReplaySource;
+
+// Function declarations
+bool OpenReplaySource(ReplaySource* source, const char* file_name, unsigned long pulse_interval);
+void CloseReplaySource(ReplaySource* source);
+bool ReadReplayPulse(ReplaySource* source, Pulse* pulse, unsigned int* channel_id);
+unsigned long ReplayPulses(struct ChannelPool* pool, ReplaySource* source, uint64_t warning_period);
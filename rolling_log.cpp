@@ -0,0 +1,323 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements memory-mapped rolling log
+
+#include "rolling_log.h"
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+// Rolling log state, written by one thread at a time: the logging thread while it runs, the main thread otherwise
+static struct
+{
+    RollingLogConfig config;
+    char header[ROLLING_LOG_HEADER_SIZE];
+    LogSegment segment;                         // Segment being written
+    char (*names)[ROLLING_LOG_NAME_SIZE];       // Names of the kept segments, a ring ordered from the oldest
+    unsigned int name_capacity;                 // Number of segments that fit into the disk limit
+    unsigned int name_count;
+    unsigned int oldest_index;
+    unsigned long segment_count;                // Number of opened segments
+    unsigned long deleted_count;                // Number of segments deleted to stay within the disk limit
+    bool open_flag;
+} rolling_log;
+
+static char rolling_log_token;
+
+FILE* const ROLLING_LOG_FILE = (FILE*)&rolling_log_token;
+
+// Purpose: This utility function unmaps the segment being written and truncates its file to the written size
+static void CloseSegment()
+{
+    LogSegment* segment = &rolling_log.segment;
+
+    if (segment->view == NULL)
+        return;
+
+#if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(segment->view);
+    CloseHandle(segment->mapping_handle);
+
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG)segment->size;
+
+    SetFilePointerEx(segment->file_handle, size, NULL, FILE_BEGIN);
+    SetEndOfFile(segment->file_handle);
+    CloseHandle(segment->file_handle);
+
+    segment->mapping_handle = NULL;
+    segment->file_handle = NULL;
+#else
+    munmap(segment->view, rolling_log.config.segment_size);
+
+    if (ftruncate(segment->file_descriptor, (off_t)segment->size) != 0)
+        fprintf(stderr, "Cannot truncate log segment\n");
+
+    close(segment->file_descriptor);
+    segment->file_descriptor = -1;
+#endif
+
+    segment->view = NULL;
+}
+
+// Purpose: This utility function deletes a segment file
+static void DeleteSegmentFile(const char* name)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    DeleteFileA(name);
+#else
+    unlink(name);
+#endif
+}
+
+// Purpose: This utility function creates, preallocates and maps the next segment and writes its header
+// The oldest segment is deleted first if the kept segments would otherwise exceed the disk limit
+// Returns: True if the segment has been mapped; false otherwise
+static bool OpenSegment()
+{
+    LogSegment* segment = &rolling_log.segment;
+
+    if (rolling_log.name_count == rolling_log.name_capacity)
+    {
+        DeleteSegmentFile(rolling_log.names[rolling_log.oldest_index]);
+
+        rolling_log.oldest_index = (rolling_log.oldest_index + 1) % rolling_log.name_capacity;
+        rolling_log.name_count--;
+        rolling_log.deleted_count++;
+    }
+
+    char* name = rolling_log.names[(rolling_log.oldest_index + rolling_log.name_count) % rolling_log.name_capacity];
+    char timestamp[LOG_TIMESTAMP_SIZE];
+
+    // The sequence number tells apart segments opened within the same second
+    CreateLogFileTimeStamp(timestamp, sizeof(timestamp));
+    snprintf(name, ROLLING_LOG_NAME_SIZE, "%s%s_%04lu%s",
+        rolling_log.config.prefix, timestamp, rolling_log.segment_count, rolling_log.config.extension);
+
+#if defined(_WIN32) || defined(_WIN64)
+    segment->file_handle = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (segment->file_handle == INVALID_HANDLE_VALUE)
+    {
+        segment->file_handle = NULL;
+        return false;
+    }
+
+    // Mapping the file at the segment size extends it, which preallocates the segment
+    segment->mapping_handle = CreateFileMappingA(segment->file_handle, NULL, PAGE_READWRITE,
+        (DWORD)((uint64_t)rolling_log.config.segment_size >> 32), (DWORD)(rolling_log.config.segment_size & 0xFFFFFFFFul), NULL);
+
+    if (segment->mapping_handle != NULL)
+        segment->view = (char*)MapViewOfFile(segment->mapping_handle, FILE_MAP_WRITE, 0, 0, rolling_log.config.segment_size);
+
+    if (segment->view == NULL)
+    {
+        if (segment->mapping_handle != NULL)
+            CloseHandle(segment->mapping_handle);
+
+        CloseHandle(segment->file_handle);
+        DeleteSegmentFile(name);
+
+        segment->mapping_handle = NULL;
+        segment->file_handle = NULL;
+        return false;
+    }
+#else
+    segment->file_descriptor = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (segment->file_descriptor < 0)
+        return false;
+
+    // Extending the file to the segment size before mapping it preallocates the segment
+    if (ftruncate(segment->file_descriptor, (off_t)rolling_log.config.segment_size) == 0)
+    {
+        void* view = mmap(NULL, rolling_log.config.segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, segment->file_descriptor, 0);
+
+        segment->view = (view != MAP_FAILED) ? (char*)view : NULL;
+    }
+
+    if (segment->view == NULL)
+    {
+        close(segment->file_descriptor);
+        DeleteSegmentFile(name);
+
+        segment->file_descriptor = -1;
+        return false;
+    }
+#endif
+
+    memcpy(segment->view, rolling_log.header, rolling_log.config.header_size);
+    segment->size = rolling_log.config.header_size;
+    segment->start_time = GetMonotonicTime();
+
+    rolling_log.name_count++;
+    rolling_log.segment_count++;
+
+    return true;
+}
+
+// Purpose: This utility function closes the segment being written and opens the next one
+// Returns: True if the next segment has been opened; false otherwise, in which case the rolling log is closed
+static bool RotateSegment()
+{
+    CloseSegment();
+
+    if (!OpenSegment())
+    {
+        rolling_log.open_flag = false;
+        return false;
+    }
+
+    return true;
+}
+
+// Purpose: This function opens the rolling log and its first segment
+// The prefix and extension strings must remain valid until the rolling log is closed
+// Params: Rolling log configuration
+// Returns: True if the first segment has been opened; false otherwise
+bool OpenRollingLog(const RollingLogConfig* config)
+{
+    if ((rolling_log.open_flag) || (config->header_size > ROLLING_LOG_HEADER_SIZE) || (config->record_size == 0) ||
+        (config->segment_size < (config->header_size + config->record_size)))
+        return false;
+
+    memset(&rolling_log, 0, sizeof(rolling_log));
+    rolling_log.config = *config;
+
+    if (config->header != NULL)
+        memcpy(rolling_log.header, config->header, config->header_size);
+    else
+        rolling_log.config.header_size = 0;
+
+    rolling_log.config.header = rolling_log.header;
+    rolling_log.name_capacity = (unsigned int)(config->disk_limit / config->segment_size);
+
+    if (rolling_log.name_capacity == 0)
+        rolling_log.name_capacity = 1;
+
+    rolling_log.names = (char(*)[ROLLING_LOG_NAME_SIZE])malloc(sizeof(*rolling_log.names) * rolling_log.name_capacity);
+
+    if (rolling_log.names == NULL)
+        return false;
+
+    if (!OpenSegment())
+    {
+        free(rolling_log.names);
+        rolling_log.names = NULL;
+        return false;
+    }
+
+    rolling_log.open_flag = true;
+
+    return true;
+}
+
+// Purpose: This function closes the rolling log, truncating the segment being written to its written size
+void CloseRollingLog()
+{
+    CloseSegment();
+
+    free(rolling_log.names);
+    rolling_log.names = NULL;
+    rolling_log.open_flag = false;
+}
+
+// Purpose: This function appends bytes to the rolling log
+// The segment is rotated before the write if it is older than the segment duration. A write that does not fit
+// into the rest of the segment goes to the next segment; only a write longer than a segment is split.
+// Params: Bytes to append and their number
+// Returns: True if all bytes have been written; false otherwise
+bool WriteRollingLog(const void* data, unsigned int len)
+{
+    const char* ptr = (const char*)data;
+    const RollingLogConfig* config = &rolling_log.config;
+    LogSegment* segment = &rolling_log.segment;
+
+    if (!rolling_log.open_flag)
+        return false;
+
+    if ((config->segment_duration > 0) && (segment->size > config->header_size) &&
+        (IsTimeout(GetMonotonicTime(), segment->start_time, config->segment_duration)))
+    {
+        if (!RotateSegment())
+            return false;
+    }
+
+    while (len > 0)
+    {
+        unsigned long space = config->segment_size - segment->size;
+        unsigned long chunk = len;
+
+        if (chunk > space)
+        {
+            // Start a new segment if the whole write fits into it
+            if ((segment->size > config->header_size) && (len <= (config->segment_size - config->header_size)))
+                chunk = 0;
+            else
+                chunk = space - (space % config->record_size);
+        }
+
+        if (chunk == 0)
+        {
+            if (!RotateSegment())
+                return false;
+
+            continue;
+        }
+
+        memcpy(&segment->view[segment->size], ptr, chunk);
+        segment->size += chunk;
+        ptr += chunk;
+        len -= (unsigned int)chunk;
+    }
+
+    return true;
+}
+
+// Purpose: This function retrieves the number of segments opened since the rolling log was opened
+unsigned long GetRollingLogSegmentCount()
+{
+    return rolling_log.segment_count;
+}
+
+// Purpose: This function retrieves the number of segments deleted to stay within the disk limit
+unsigned long GetRollingLogDeletedCount()
+{
+    return rolling_log.deleted_count;
+}
+
+// Purpose: This function writes bytes to the log file, which is either the rolling log or a stdio file
+// Params: Bytes to write, their number and the log file pointer
+// Returns: True if all bytes have been written; false otherwise
+bool WriteLogFile(const void* data, unsigned int len, FILE* fptr)
+{
+    if (fptr == NULL)
+        return false;
+
+    if (fptr == ROLLING_LOG_FILE)
+        return WriteRollingLog(data, len);
+
+    return (fwrite(data, 1, len, fptr) == len);
+}
+
+// Purpose: This function flushes buffered bytes of a stdio log file
+// The mapped segments of the rolling log need no flushing; they are written back by the system
+void FlushLogFile(FILE* fptr)
+{
+    if ((fptr != NULL) && (fptr != ROLLING_LOG_FILE))
+        fflush(fptr);
+}
+
+// Purpose: This function closes the log file, which is either the rolling log or a stdio file
+void CloseLogFile(FILE* fptr)
+{
+    if (fptr == ROLLING_LOG_FILE)
+        CloseRollingLog();
+    else if (fptr != NULL)
+        fclose(fptr);
+}
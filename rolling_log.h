@@ -0,0 +1,60 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines memory-mapped rolling log
+
+#pragma once
+
+#include "functions.h"
+
+// The rolling log writes the log into a sequence of segment files, each preallocated to the segment size
+// and mapped into memory, so that an append is a copy into the mapped view. A segment is closed and truncated
+// to its written size once it is full or older than the segment duration, and the next segment is mapped in its place.
+// Only as many segments as fit into the disk limit are kept; the oldest segment is deleted to make room for a new one.
+// Every segment starts with the configured header, so each segment can be read on its own, and a write is
+// never split across segments at other than a whole number of records.
+// The rolling log stands in for the log file pointer: modules that log keep taking a file pointer and
+// write through WriteLogFile, which appends to the rolling log when given ROLLING_LOG_FILE.
+
+#define ROLLING_LOG_NAME_SIZE       64      // Maximum segment file name length, including the terminator
+#define ROLLING_LOG_HEADER_SIZE     64      // Maximum segment header size (bytes)
+
+// Rolling log configuration
+typedef struct
+{
+    const char* prefix;             // Segment file name prefix
+    const char* extension;          // Segment file name extension
+    unsigned long segment_size;     // Preallocated size of a segment (bytes)
+    uint64_t segment_duration;      // Longest time a segment is written to, 0 for no limit (microseconds)
+    unsigned long disk_limit;       // Largest total size of the kept segments (bytes)
+    unsigned int record_size;       // Writes are split across segments at multiples of the record size (bytes)
+    const void* header;             // Written at the start of every segment, may be NULL
+    unsigned int header_size;       // Bytes
+} RollingLogConfig;
+
+// Mapped segment of the rolling log
+typedef struct
+{
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#else
+    int file_descriptor;            // -1 while no segment is open
+#endif
+    char* view;                     // Mapped contents of the segment
+    unsigned long size;             // Number of bytes written
+    uint64_t start_time;            // Monotonic time the segment was opened (microseconds)
+} LogSegment;
+
+// Stands in for the log file pointer while the rolling log is open; it must never be passed to stdio
+extern FILE* const ROLLING_LOG_FILE;
+
+// Function declarations
+bool OpenRollingLog(const RollingLogConfig* config);
+void CloseRollingLog();
+bool WriteRollingLog(const void* data, unsigned int len);
+unsigned long GetRollingLogSegmentCount();
+unsigned long GetRollingLogDeletedCount();
+bool WriteLogFile(const void* data, unsigned int len, FILE* fptr);
+void FlushLogFile(FILE* fptr);
+void CloseLogFile(FILE* fptr);
@@ -0,0 +1,88 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines compile-time sensor calibration
+
+#pragma once
+
+#include <utility>
+
+// A temperature sensor reports the temperature as the width of an electrical pulse:
+// temperature = (pulse width - offset) * scale, where the scale is the rational number ScaleNumerator / ScaleDenominator.
+// Keeping the scale rational makes the inverse conversion exact, and lets the pulse width equivalent of 
+// a temperature limit be computed at compile time in integers: a pulse (or a doubled median, which represents 
+// even-count averages exactly) exceeds the limit exactly when its raw value exceeds the value returned below, 
+// so the hot path never converts a pulse to a temperature to decide on an alert.
+// The temperatures of the bounded pulse width range are tabulated at compile time in half-millisecond 
+// steps, so rendering a pulse or a median is a table lookup.
+
+// Temperatures of a bounded pulse width range, one per half millisecond
+template <unsigned int Count>
+struct SensorTempTable
+{
+    double temps[Count];
+};
+
+// Sensor calibration
+template <unsigned short Offset, unsigned int ScaleNumerator, unsigned int ScaleDenominator>
+struct SensorCalibration
+{
+    static constexpr unsigned short offset = Offset;                                // Milliseconds
+    static constexpr double scale = double(ScaleNumerator) / ScaleDenominator;     // Degrees Celsius per millisecond
+
+    // Purpose: This function converts an electrical pulse width (milliseconds) to its temperature value (degrees Celsius)
+    static constexpr double ConvertToTemp(double pulse_width)
+    {
+        return (pulse_width - Offset) * scale;
+    }
+
+    // Purpose: This function converts a temperature value (degrees Celsius) to its electrical pulse width (milliseconds)
+    static constexpr double ConvertToPulseWidth(double temp)
+    {
+        return (temp * ScaleDenominator) / ScaleNumerator + Offset;
+    }
+
+    // Purpose: This function retrieves the largest pulse width (milliseconds) whose temperature does not exceed the limit
+    // Params: Temperature limit (degrees Celsius, non-negative)
+    static constexpr unsigned short GetPulseWidthLimit(unsigned int temp_limit)
+    {
+        return (unsigned short)(Offset + (temp_limit * ScaleDenominator) / ScaleNumerator);
+    }
+
+    // Purpose: This function retrieves the largest doubled pulse width whose temperature does not exceed the limit
+    // Params: Temperature limit (degrees Celsius, non-negative)
+    static constexpr unsigned int GetDoubledPulseWidthLimit(unsigned int temp_limit)
+    {
+        return (2u * Offset) + ((2u * temp_limit * ScaleDenominator) / ScaleNumerator);
+    }
+
+    // Purpose: This function tabulates the temperatures of the doubled pulse widths [2 * Lower, 2 * Upper]
+    template <unsigned short Lower, unsigned short Upper, std::size_t... Index>
+    static constexpr SensorTempTable<2u * (Upper - Lower) + 1u> MakeTempTable(std::index_sequence<Index...>)
+    {
+        return {{ ConvertToTemp(Lower + Index / 2.0)... }};
+    }
+
+    template <unsigned short Lower, unsigned short Upper>
+    static constexpr SensorTempTable<2u * (Upper - Lower) + 1u> MakeTempTable()
+    {
+        return MakeTempTable<Lower, Upper>(std::make_index_sequence<2u * (Upper - Lower) + 1u>());
+    }
+};
+
+// Calibration of the thermostat sensors: 0.75 milliseconds per degree Celsius above 5 milliseconds
+typedef SensorCalibration<5, 4, 3> ThermostatCalibration;
+
+// Valid pulse signal range boundaries shared by the pulse generator, the median windows and the lookup table
+constexpr unsigned short pulse_width_lower_limit = 30;  // Milliseconds
+constexpr unsigned short pulse_width_upper_limit = 80;  // Milliseconds
+
+// Temperature limit above which warnings are generated and its compile-time pulse width equivalents
+constexpr unsigned int warning_temp_limit = 70;         // Degrees Celsius
+constexpr unsigned short pulse_width_warning_threshold = ThermostatCalibration::GetPulseWidthLimit(warning_temp_limit);
+constexpr unsigned int median_warning_threshold = ThermostatCalibration::GetDoubledPulseWidthLimit(warning_temp_limit);
+
+static_assert(pulse_width_warning_threshold == 57, "70 degrees Celsius lies between pulse widths 57 and 58");
+static_assert(median_warning_threshold == 115, "70 degrees Celsius is pulse width 57.5");
+static_assert(ThermostatCalibration::ConvertToTemp(ThermostatCalibration::ConvertToPulseWidth(warning_temp_limit)) == warning_temp_limit, 
+    "Forward and inverse conversions must be exact inverses");
@@ -0,0 +1,411 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements runtime settings
+
+#include <stddef.h>
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <sys/stat.h>
+#endif
+
+#include "settings.h"
+
+// Types of setting values
+typedef enum {
+    SETTING_TYPE_UINT,
+    SETTING_TYPE_ULONG,
+    SETTING_TYPE_UINT64,
+    SETTING_TYPE_BOOL,
+    SETTING_TYPE_ENUM           // Stored as int, named by a NULL-terminated list of value names
+} SETTING_TYPE;
+
+// Description of a setting
+typedef struct
+{
+    const char* name;
+    SETTING_TYPE type;
+    size_t offset;                      // Offset of the setting within the settings
+    const char* const* value_names;     // Names of the enumeration values in the order of their values
+    uint64_t min_value;
+    uint64_t max_value;
+    bool reloadable_flag;               // Taken over from a reloaded settings file
+} SettingDescriptor;
+
+static_assert((sizeof(MEDIAN_MODE) == sizeof(int)) && (sizeof(LOG_SINK) == sizeof(int)) &&
+    (sizeof(PULSE_DISTRIBUTION) == sizeof(int)) && (sizeof(PRIORITY_LEVEL) == sizeof(int)), "Enumerated settings are stored as int");
+
+// The window of a channel drives the alerts, so it is always exact; the quantile backend serves the trend windows
+static const char* const median_mode_names[] = { "list", "heap", "histogram", NULL };
+static const char* const log_sink_names[] = { "text", "binary", NULL };
+static const char* const log_level_names[] = { "trace", "pulse", "median", "alert", "none", NULL };
+static const char* const pulse_distribution_names[] = { "uniform", "normal", "step", "ramp", NULL };
+static const char* const priority_level_names[] = { "normal", "high", "realtime", NULL };
+
+static const SettingDescriptor setting_descriptors[] = {
+    { "warning_temp_limit", SETTING_TYPE_UINT, offsetof(Settings, warning_temp_limit), NULL, 0, 1000, true },
+    { "warning_threshold", SETTING_TYPE_ULONG, offsetof(Settings, warning_threshold), NULL, 0, 3600000, true },
+    { "measurement_duration_limit", SETTING_TYPE_ULONG, offsetof(Settings, measurement_duration_limit), NULL, 0, 0xFFFFFFFFul, false },
+    { "pulse_interval", SETTING_TYPE_ULONG, offsetof(Settings, pulse_interval), NULL, 0, 60000, false },
+    { "warning_period", SETTING_TYPE_ULONG, offsetof(Settings, warning_period), NULL, 1, 60000, false },
+    { "stats_interval", SETTING_TYPE_ULONG, offsetof(Settings, stats_interval), NULL, 1, 0xFFFFFFFFul, false },
+    { "reload_interval", SETTING_TYPE_ULONG, offsetof(Settings, reload_interval), NULL, 0, 0xFFFFFFFFul, false },
+    { "channel_count", SETTING_TYPE_UINT, offsetof(Settings, channel_count), NULL, 1, 1024, false },
+    { "window_capacity", SETTING_TYPE_UINT, offsetof(Settings, window_capacity), NULL, 1, 16777216, false },
+    { "pulse_queue_capacity", SETTING_TYPE_UINT, offsetof(Settings, pulse_queue_capacity), NULL, 1, 16777216, false },
+    { "median_mode", SETTING_TYPE_ENUM, offsetof(Settings, median_mode), median_mode_names, 0, 0, false },
+    { "log_sink", SETTING_TYPE_ENUM, offsetof(Settings, log_sink), log_sink_names, 0, 0, false },
+    { "log_level", SETTING_TYPE_ENUM, offsetof(Settings, log_level), log_level_names, 0, 0, false },
+    { "pulse_distribution", SETTING_TYPE_ENUM, offsetof(Settings, pulse_distribution), pulse_distribution_names, 0, 0, false },
+    { "pulse_seed", SETTING_TYPE_UINT64, offsetof(Settings, pulse_seed), NULL, 0, UINT64_MAX, false },
+    { "batch_ingest", SETTING_TYPE_BOOL, offsetof(Settings, batch_ingest), NULL, 0, 1, false },
+    { "log_segment_size", SETTING_TYPE_ULONG, offsetof(Settings, log_segment_size), NULL, 0, 0x7FFFFFFFul, false },
+    { "log_segment_duration", SETTING_TYPE_ULONG, offsetof(Settings, log_segment_duration), NULL, 0, 0xFFFFFFFFul, false },
+    { "log_disk_limit", SETTING_TYPE_ULONG, offsetof(Settings, log_disk_limit), NULL, 0, 0xFFFFFFFFul, false },
+    { "worker_affinity", SETTING_TYPE_BOOL, offsetof(Settings, worker_affinity), NULL, 0, 1, false },
+    { "first_worker_cpu", SETTING_TYPE_UINT, offsetof(Settings, first_worker_cpu), NULL, 0, 1023, false },
+    { "worker_priority", SETTING_TYPE_ENUM, offsetof(Settings, worker_priority), priority_level_names, 0, 0, false },
+    { "pulse_priority", SETTING_TYPE_ENUM, offsetof(Settings, pulse_priority), priority_level_names, 0, 0, false },
+    { "warning_priority", SETTING_TYPE_ENUM, offsetof(Settings, warning_priority), priority_level_names, 0, 0, false }
+};
+
+#define SETTING_COUNT (sizeof(setting_descriptors) / sizeof(setting_descriptors[0]))
+
+// Purpose: This function sets the default settings
+void InitSettings(Settings* settings)
+{
+    memset(settings, 0, sizeof(Settings));
+
+    settings->warning_temp_limit = warning_temp_limit;
+    settings->warning_threshold = 1000;
+    settings->measurement_duration_limit = 10000;
+    settings->pulse_interval = 20;
+    settings->warning_period = 5;
+    settings->stats_interval = 5000;
+    settings->reload_interval = 1000;
+    settings->channel_count = 1;
+    settings->window_capacity = 4096;
+    settings->pulse_queue_capacity = 1024;
+    settings->median_mode = MEDIAN_MODE_HISTOGRAM;
+    settings->log_sink = LOG_SINK_TEXT;
+    settings->log_level = LOG_LEVEL_TRACE;
+    settings->pulse_distribution = PULSE_DISTRIBUTION_UNIFORM;
+    settings->pulse_seed = 0;
+    settings->batch_ingest = false;
+    settings->log_segment_size = 4194304;
+    settings->log_segment_duration = 60000;
+    settings->log_disk_limit = 67108864;
+    settings->worker_affinity = false;
+    settings->first_worker_cpu = 0;
+    settings->worker_priority = PRIORITY_LEVEL_NORMAL;
+    settings->pulse_priority = PRIORITY_LEVEL_NORMAL;
+    settings->warning_priority = PRIORITY_LEVEL_NORMAL;
+    settings->settings_file_name = NULL;
+    settings->replay_file_name = NULL;
+    settings->settings_file_time = 0;
+}
+
+// Purpose: This utility function parses an unsigned decimal number that must make up the whole string
+// Returns: True if the string is a number; false otherwise
+static bool ParseNumber(const char* str, uint64_t* value)
+{
+    char* end_ptr = NULL;
+
+    if ((*str < '0') || (*str > '9'))
+        return false;
+
+    *value = strtoull(str, &end_ptr, 10);
+
+    return (*end_ptr == '\0');
+}
+
+// Purpose: This utility function parses the value of a setting and stores it
+// Params: Settings, the setting description and its value
+// Returns: True if the value is valid; false otherwise
+static bool ParseSettingValue(Settings* settings, const SettingDescriptor* descriptor, const char* str)
+{
+    char* ptr = (char*)settings + descriptor->offset;
+    uint64_t value = 0;
+
+    switch (descriptor->type)
+    {
+    case SETTING_TYPE_BOOL:
+        if ((strcmp(str, "true") == 0) || (strcmp(str, "yes") == 0) || (strcmp(str, "1") == 0))
+            *(bool*)ptr = true;
+        else if ((strcmp(str, "false") == 0) || (strcmp(str, "no") == 0) || (strcmp(str, "0") == 0))
+            *(bool*)ptr = false;
+        else
+            return false;
+
+        return true;
+
+    case SETTING_TYPE_ENUM:
+        for (int i = 0; descriptor->value_names[i] != NULL; i++)
+        {
+            if (strcmp(str, descriptor->value_names[i]) == 0)
+            {
+                memcpy(ptr, &i, sizeof(int));
+                return true;
+            }
+        }
+
+        return false;
+
+    default:
+        if ((!ParseNumber(str, &value)) || (value < descriptor->min_value) || (value > descriptor->max_value))
+            return false;
+
+        if (descriptor->type == SETTING_TYPE_UINT)
+            *(unsigned int*)ptr = (unsigned int)value;
+        else if (descriptor->type == SETTING_TYPE_ULONG)
+            *(unsigned long*)ptr = (unsigned long)value;
+        else
+            *(uint64_t*)ptr = value;
+
+        return true;
+    }
+}
+
+// Purpose: This utility function sets a setting by its name
+// Params: Settings, the setting name and value and whether only the reloadable settings are to be set
+// Returns: True if the setting exists and its value is valid; false otherwise
+static bool SetSetting(Settings* settings, const char* name, const char* value, bool reload_flag)
+{
+    for (unsigned int i = 0; i < SETTING_COUNT; i++)
+    {
+        const SettingDescriptor* descriptor = &setting_descriptors[i];
+
+        if (strcmp(name, descriptor->name) != 0)
+            continue;
+
+        // Settings that take effect at startup only are still validated
+        if (reload_flag && (!descriptor->reloadable_flag))
+        {
+            Settings scratch = *settings;
+            return ParseSettingValue(&scratch, descriptor, value);
+        }
+
+        return ParseSettingValue(settings, descriptor, value);
+    }
+
+    return false;
+}
+
+// Purpose: This utility function removes leading and trailing white space from a string in place
+static char* TrimString(char* str)
+{
+    while ((*str == ' ') || (*str == '\t'))
+        str++;
+
+    size_t len = strlen(str);
+
+    while ((len > 0) && ((str[len - 1] == ' ') || (str[len - 1] == '\t') || (str[len - 1] == '\r') || (str[len - 1] == '\n')))
+        str[--len] = '\0';
+
+    return str;
+}
+
+// Purpose: This utility function retrieves the last write time of a file
+// Returns: True if the file exists; false otherwise
+static bool GetFileWriteTime(const char* file_name, uint64_t* write_time)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesExA(file_name, GetFileExInfoStandard, &data))
+        return false;
+
+    *write_time = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat data;
+
+    if (stat(file_name, &data) != 0)
+        return false;
+
+    // Nanoseconds, so a file rewritten within the same second is still seen as changed
+    *write_time = (uint64_t)data.st_mtim.tv_sec * 1000000000ull + (uint64_t)data.st_mtim.tv_nsec;
+#endif
+
+    return true;
+}
+
+// Purpose: This utility function reads a settings file
+// Params: Settings, the settings file name and whether only the reloadable settings are to be set
+// Returns: True if every line of the file is valid; false otherwise
+static bool ReadSettingsFile(Settings* settings, const char* file_name, bool reload_flag)
+{
+    FILE* fptr = fopen(file_name, "r");
+    char line[SETTINGS_LINE_SIZE];
+    unsigned int line_number = 0;
+    bool valid_flag = true;
+
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "Cannot open %s\n", file_name);
+        return false;
+    }
+
+    while (valid_flag && (fgets(line, sizeof(line), fptr) != NULL))
+    {
+        line_number++;
+
+        // A comment runs to the end of the line
+        char* comment = strchr(line, '#');
+
+        if (comment != NULL)
+            *comment = '\0';
+
+        char* name = TrimString(line);
+
+        if (*name == '\0')
+            continue;
+
+        char* separator = strchr(name, '=');
+
+        if (separator == NULL)
+        {
+            fprintf(stderr, "%s:%u: Expected name = value\n", file_name, line_number);
+            valid_flag = false;
+            break;
+        }
+
+        *separator = '\0';
+        name = TrimString(name);
+
+        char* value = TrimString(separator + 1);
+
+        if (!SetSetting(settings, name, value, reload_flag))
+        {
+            fprintf(stderr, "%s:%u: Invalid setting %s = %s\n", file_name, line_number, name, value);
+            valid_flag = false;
+        }
+    }
+
+    fclose(fptr);
+
+    return valid_flag;
+}
+
+// Purpose: This utility function applies the settings given on the command line
+// Params: Settings, the argument count, the arguments and whether only the reloadable settings are to be set
+// Returns: True if the command line is valid; false otherwise
+static bool ApplyCommandLine(Settings* settings, int argc, char* argv[], bool reload_flag)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--", 2) != 0)
+        {
+            fprintf(stderr, "Unexpected argument %s\n", argv[i]);
+            return false;
+        }
+
+        const char* name = argv[i] + 2;
+
+        // Run until a shutdown is requested
+        if (strcmp(name, "daemon") == 0)
+        {
+            if (!reload_flag)
+                settings->measurement_duration_limit = 0;
+
+            continue;
+        }
+
+        if ((i + 1) >= argc)
+        {
+            fprintf(stderr, "Missing value of %s\n", argv[i]);
+            return false;
+        }
+
+        const char* value = argv[++i];
+
+        if (strcmp(name, "config") == 0)
+            continue;
+
+        if (strcmp(name, "replay") == 0)
+        {
+            if (!reload_flag)
+                settings->replay_file_name = value;
+
+            continue;
+        }
+
+        if (!SetSetting(settings, name, value, reload_flag))
+        {
+            fprintf(stderr, "Invalid setting %s %s\n", argv[i - 1], value);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Purpose: This function loads the settings from a settings file
+// Params: Settings and the settings file name
+// Returns: True if the settings file has been loaded; false otherwise
+bool LoadSettingsFile(Settings* settings, const char* file_name)
+{
+    settings->settings_file_name = file_name;
+
+    if (!GetFileWriteTime(file_name, &settings->settings_file_time))
+        settings->settings_file_time = 0;
+
+    return ReadSettingsFile(settings, file_name, false);
+}
+
+// Purpose: This function reloads the alert thresholds if the settings file has changed since it was last loaded
+// The reloadable settings given on the command line are applied again, so they keep overriding the settings file
+// A settings file with an invalid line is rejected as a whole and the current settings are kept
+// Returns: True if new settings have been loaded; false otherwise
+bool ReloadSettingsFile(Settings* settings)
+{
+    uint64_t write_time = 0;
+
+    if ((settings->settings_file_name == NULL) || (!GetFileWriteTime(settings->settings_file_name, &write_time)) ||
+        (write_time == settings->settings_file_time))
+        return false;
+
+    // The write time is taken over even if the file is rejected, so a broken file is reported once
+    settings->settings_file_time = write_time;
+
+    Settings reloaded = *settings;
+
+    if (!ReadSettingsFile(&reloaded, settings->settings_file_name, true))
+        return false;
+
+    // A command line option still overrides the settings file; it has been validated at startup
+    ApplyCommandLine(&reloaded, settings->argc, settings->argv, true);
+
+    *settings = reloaded;
+
+    return true;
+}
+
+// Purpose: This function parses the command line, loading the settings file given on it first
+// The command line is kept, so its reloadable settings keep overriding the settings file after every reload
+// Params: Settings, the argument count and the arguments
+// Returns: True if the command line and the settings file are valid; false otherwise
+bool ParseSettings(Settings* settings, int argc, char* argv[])
+{
+    for (int i = 1; i < (argc - 1); i++)
+    {
+        if ((strcmp(argv[i], "--config") == 0) && (!LoadSettingsFile(settings, argv[i + 1])))
+            return false;
+    }
+
+    settings->argc = argc;
+    settings->argv = argv;
+
+    return ApplyCommandLine(settings, argc, argv, false);
+}
+
+// Purpose: This function prints the command line usage and the names of the settings
+void PrintSettingsUsage(const char* program_name)
+{
+    fprintf(stderr, "Usage: %s [--config <settings file>] [--replay <log file>] [--daemon] [--<setting> <value>]...\n", program_name);
+    fprintf(stderr, "Settings (* reloadable):");
+
+    for (unsigned int i = 0; i < SETTING_COUNT; i++)
+        fprintf(stderr, " %s%s", setting_descriptors[i].name, setting_descriptors[i].reloadable_flag ? "*" : "");
+
+    fprintf(stderr, "\n");
+}
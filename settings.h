@@ -0,0 +1,62 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines runtime settings
+
+#pragma once
+
+#include "functions.h"
+#include "median_window.h"
+#include "logger.h"
+#include "pulse_generator.h"
+#include "platform.h"
+
+// The settings are loaded once at startup from an optional settings file and then from the command line,
+// so a command line option overrides the settings file. The settings file holds one "name = value" pair per line;
+// a '#' starts a comment that runs to the end of the line. On the command line a setting is given as "--name value".
+// While running, the settings file can be checked for changes and reloaded. Only the alert thresholds are taken over
+// from a reloaded settings file; every other setting takes effect at startup only. A threshold given on the command line 
+// keeps overriding the settings file after every reload.
+
+#define SETTINGS_LINE_SIZE 256      // Longest settings file line, including the terminator
+
+// Runtime settings
+typedef struct
+{
+    unsigned int warning_temp_limit;            // Temperature above which warnings are generated (degrees Celsius, reloadable)
+    unsigned long warning_threshold;            // Longest alert before the alarm (milliseconds, reloadable)
+    unsigned long measurement_duration_limit;   // Milliseconds, 0 runs until a shutdown is requested
+    unsigned long pulse_interval;               // Time between the end of a simulated pulse and the start of the next (milliseconds)
+    unsigned long warning_period;               // Milliseconds
+    unsigned long stats_interval;               // Milliseconds between statistics dumps (positive)
+    unsigned long reload_interval;              // Milliseconds between checks of the settings file for changes, 0 for none
+    unsigned int channel_count;                 // Number of thermostat channels
+    unsigned int window_capacity;               // Maximum number of pulses in the longest window, raised to cover the longest exact window at the highest pulse rate
+    unsigned int pulse_queue_capacity;          // Maximum number of pulses waiting to be processed
+    MEDIAN_MODE median_mode;                    // Median calculation mode
+    LOG_SINK log_sink;                          // Text or binary log file
+    int log_level;                              // Lowest log level to output
+    PULSE_DISTRIBUTION pulse_distribution;      // Simulated pulse width distribution
+    uint64_t pulse_seed;                        // Seed of the simulated sensors, 0 seeds from the system time
+    bool batch_ingest;                          // One median update per drained batch of pulses
+    unsigned long log_segment_size;             // Bytes per rolling log segment, 0 writes a single log file
+    unsigned long log_segment_duration;         // Milliseconds a rolling log segment is written to, 0 for no limit
+    unsigned long log_disk_limit;               // Bytes of rolling log segments kept on disk
+    bool worker_affinity;                       // Pin worker i to processor first_worker_cpu + i
+    unsigned int first_worker_cpu;              // Zero-based processor of the first worker
+    PRIORITY_LEVEL worker_priority;             // Scheduling priority of the worker threads
+    PRIORITY_LEVEL pulse_priority;              // Scheduling priority of the pulse thread
+    PRIORITY_LEVEL warning_priority;            // Scheduling priority of the warning thread
+    const char* settings_file_name;             // Settings file, NULL if none
+    const char* replay_file_name;               // Recorded log file to replay, NULL to simulate the sensors
+    uint64_t settings_file_time;                // Last write time of the settings file when it was last loaded
+    int argc;                                   // Command line, applied again after every reload
+    char** argv;
+} Settings;
+
+// Function declarations
+void InitSettings(Settings* settings);
+bool ParseSettings(Settings* settings, int argc, char* argv[]);
+bool LoadSettingsFile(Settings* settings, const char* file_name);
+bool ReloadSettingsFile(Settings* settings);
+void PrintSettingsUsage(const char* program_name);
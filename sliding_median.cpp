@@ -0,0 +1,291 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements sliding window median engine
+
+#include "sliding_median.h"
+#include "binary_log.h"
+#include "pulse_kernels.h"
+
+// The companion index of a ring slot holds the heap position of the pulse, 
+// with the top bit set for the pulses stored in the upper half
+#define UPPER_HEAP_FLAG 0x80000000u
+
+// Purpose: This utility function checks whether a heap element must be placed above another one
+// The lower half is a max-heap and the upper half is a min-heap
+static bool IsAbove(const SlidingMedian* sliding_median, bool lower, unsigned int index_a, unsigned int index_b)
+{
+    unsigned short width_a = sliding_median->ring.widths[index_a];
+    unsigned short width_b = sliding_median->ring.widths[index_b];
+
+    return lower ? (width_a > width_b) : (width_a < width_b);
+}
+
+// Purpose: This utility function places a ring slot at the given heap position
+static void PlaceInHeap(SlidingMedian* sliding_median, bool lower, unsigned int pos, unsigned int index)
+{
+    unsigned int* heap = lower ? sliding_median->lower_heap : sliding_median->upper_heap;
+
+    heap[pos] = index;
+    sliding_median->ring.indices[index] = lower ? pos : (pos | UPPER_HEAP_FLAG);
+}
+
+// Purpose: This utility function moves a heap element up until the heap property is restored
+static void SiftUp(SlidingMedian* sliding_median, bool lower, unsigned int pos)
+{
+    unsigned int* heap = lower ? sliding_median->lower_heap : sliding_median->upper_heap;
+    unsigned int index = heap[pos];
+
+    while (pos > 0)
+    {
+        unsigned int parent = (pos - 1) / 2;
+
+        if (!IsAbove(sliding_median, lower, index, heap[parent]))
+            break;
+
+        PlaceInHeap(sliding_median, lower, pos, heap[parent]);
+        pos = parent;
+    }
+
+    PlaceInHeap(sliding_median, lower, pos, index);
+}
+
+// Purpose: This utility function moves a heap element down until the heap property is restored
+static void SiftDown(SlidingMedian* sliding_median, bool lower, unsigned int pos)
+{
+    unsigned int* heap = lower ? sliding_median->lower_heap : sliding_median->upper_heap;
+    unsigned int count = lower ? sliding_median->lower_count : sliding_median->upper_count;
+    unsigned int index = heap[pos];
+
+    while (true)
+    {
+        unsigned int child = (2 * pos) + 1;
+
+        if (child >= count)
+            break;
+
+        if (((child + 1) < count) && IsAbove(sliding_median, lower, heap[child + 1], heap[child]))
+            child++;
+
+        if (!IsAbove(sliding_median, lower, heap[child], index))
+            break;
+
+        PlaceInHeap(sliding_median, lower, pos, heap[child]);
+        pos = child;
+    }
+
+    PlaceInHeap(sliding_median, lower, pos, index);
+}
+
+// Purpose: This utility function adds a ring slot to a heap
+static void PushHeap(SlidingMedian* sliding_median, bool lower, unsigned int index)
+{
+    unsigned int pos = lower ? sliding_median->lower_count++ : sliding_median->upper_count++;
+
+    PlaceInHeap(sliding_median, lower, pos, index);
+    SiftUp(sliding_median, lower, pos);
+}
+
+// Purpose: This utility function removes an element at the given position from a heap
+// Returns: The ring slot that has been removed
+static unsigned int RemoveFromHeap(SlidingMedian* sliding_median, bool lower, unsigned int pos)
+{
+    unsigned int* heap = lower ? sliding_median->lower_heap : sliding_median->upper_heap;
+    unsigned int last = lower ? --sliding_median->lower_count : --sliding_median->upper_count;
+    unsigned int index = heap[pos];
+
+    if (pos != last)
+    {
+        unsigned int moved = heap[last];
+
+        // The last element fills the gap and moves either up or down
+        PlaceInHeap(sliding_median, lower, pos, moved);
+        SiftUp(sliding_median, lower, pos);
+
+        if ((sliding_median->ring.indices[moved] & ~UPPER_HEAP_FLAG) == pos)
+            SiftDown(sliding_median, lower, pos);
+    }
+
+    return index;
+}
+
+// Purpose: This utility function keeps the lower half equal in size to the upper half or larger by one element
+static void Rebalance(SlidingMedian* sliding_median)
+{
+    if (sliding_median->lower_count > (sliding_median->upper_count + 1))
+    {
+        PushHeap(sliding_median, false, RemoveFromHeap(sliding_median, true, 0));
+    }
+    else if (sliding_median->upper_count > sliding_median->lower_count)
+    {
+        PushHeap(sliding_median, true, RemoveFromHeap(sliding_median, false, 0));
+    }
+}
+
+// Purpose: This utility function removes the oldest pulse from the window
+static void RemoveOldest(SlidingMedian* sliding_median)
+{
+    unsigned int index = sliding_median->ring.indices[sliding_median->ring.oldest];
+
+    RemoveFromHeap(sliding_median, (index & UPPER_HEAP_FLAG) == 0, index & ~UPPER_HEAP_FLAG);
+    Rebalance(sliding_median);
+
+    PopOldestPulse(&sliding_median->ring);
+}
+
+// Purpose: This function initializes sliding window median engine
+// Params: A pointer to the engine, maximum number of pulses in the window and window length (microseconds)
+// Returns: True if the engine storage has been allocated; false otherwise
+bool InitSlidingMedian(SlidingMedian* sliding_median, unsigned int capacity, uint64_t window_length)
+{
+    bool ring_ok = InitPulseRing(&sliding_median->ring, capacity);
+
+    sliding_median->lower_heap = (unsigned int*)malloc(sizeof(unsigned int) * capacity);
+    sliding_median->upper_heap = (unsigned int*)malloc(sizeof(unsigned int) * capacity);
+    sliding_median->lower_count = 0;
+    sliding_median->upper_count = 0;
+    sliding_median->window_length = window_length;
+    sliding_median->truncated_count = 0;
+
+    if ((!ring_ok) || (sliding_median->lower_heap == NULL) || (sliding_median->upper_heap == NULL))
+    {
+        FreeSlidingMedian(sliding_median);
+        return false;
+    }
+
+    return true;
+}
+
+// Purpose: This function releases sliding window median engine storage
+void FreeSlidingMedian(SlidingMedian* sliding_median)
+{
+    FreePulseRing(&sliding_median->ring);
+    free(sliding_median->lower_heap);
+    free(sliding_median->upper_heap);
+
+    sliding_median->lower_heap = NULL;
+    sliding_median->upper_heap = NULL;
+    sliding_median->lower_count = 0;
+    sliding_median->upper_count = 0;
+}
+
+// Purpose: This function evicts pulses with stale data, if any are found
+// Pulses with stale data have their timestamp values smaller by more than the window length 
+// than that of the new pulse to be added. Only the expired pulses at the oldest end are visited.
+// Params: A pointer to the engine and the youngest timestamp
+// Returns: The number of evicted pulses
+unsigned int EvictStalePulses(SlidingMedian* sliding_median, uint64_t timestamp, FILE* fptr)
+{
+    unsigned int evicted = 0;
+
+    if (sliding_median->ring.count == 0)
+        return 0;
+
+    // Compile-time false if trace records are compiled out
+    const bool trace_flag = LOG_ENABLED(LOG_LEVEL_TRACE);
+
+    if (trace_flag)
+        PrintStr("Stale: ", fptr);
+
+    while (IsOldestPulseStale(&sliding_median->ring, timestamp, sliding_median->window_length))
+    {
+        unsigned int slot = sliding_median->ring.oldest;
+
+        if (trace_flag)
+            PrintTemp(ConvertDoubledPulseWidthToTemp(2u * sliding_median->ring.widths[slot]), fptr);
+
+        LogBinaryRecord(RECORD_STALE_PULSE, sliding_median->ring.widths[slot], 0, sliding_median->ring.timestamps[slot], fptr);
+        RemoveOldest(sliding_median);
+        evicted++;
+    }
+
+    if (trace_flag)
+        PrintStr("\n", fptr);
+
+    return evicted;
+}
+
+// Purpose: This function adds a new pulse to the window
+// If the window is full, the oldest pulse is dropped to make room for the new one and recorded 
+// in the binary log as a stale pulse, so that a converted log accounts for it
+// Params: A pointer to the engine, a pulse with the youngest timestamp and the log file pointer
+void AddPulse(SlidingMedian* sliding_median, Pulse pulse, FILE* fptr)
+{
+    if (sliding_median->ring.capacity == 0)
+        return;
+
+    if (IsPulseRingFull(&sliding_median->ring))
+    {
+        unsigned int slot = sliding_median->ring.oldest;
+
+        LogBinaryRecord(RECORD_STALE_PULSE, sliding_median->ring.widths[slot], 0, sliding_median->ring.timestamps[slot], fptr);
+        RemoveOldest(sliding_median);
+        sliding_median->truncated_count++;
+    }
+
+    unsigned int index = PushPulse(&sliding_median->ring, pulse);
+
+    // Pulses not larger than the top of the lower half belong to the lower half
+    bool lower = (sliding_median->lower_count == 0) || 
+        (pulse.width <= sliding_median->ring.widths[sliding_median->lower_heap[0]]);
+
+    PushHeap(sliding_median, lower, index);
+    Rebalance(sliding_median);
+}
+
+// Purpose: This function retrieves the median pulse width of the window
+// Returns: Twice the median pulse width or 0 if the window is empty
+unsigned int GetMedian(const SlidingMedian* sliding_median)
+{
+    if (sliding_median->lower_count == 0)
+        return 0;
+
+    unsigned short lower_top = sliding_median->ring.widths[sliding_median->lower_heap[0]];
+
+    // The window contains odd number of pulses. Hence, simply return the middle element
+    if (sliding_median->lower_count > sliding_median->upper_count)
+        return 2u * lower_top;
+
+    unsigned short upper_top = sliding_median->ring.widths[sliding_median->upper_heap[0]];
+
+    return (unsigned int)lower_top + upper_top;
+}
+
+// Purpose: This utility function compares two pulse widths for sorting
+static int CompareWidths(const void* a, const void* b)
+{
+    return (int)(*(const unsigned short*)a) - (int)(*(const unsigned short*)b);
+}
+
+// Purpose: This function prints contents of the window in the ascending order
+void PrintSlidingMedian(const SlidingMedian* sliding_median, FILE* fptr)
+{
+#if defined(PRINTF_MODE) && (LOG_MIN_LEVEL <= LOG_LEVEL_TRACE)
+    if (!LOG_ENABLED(LOG_LEVEL_TRACE))
+        return;
+
+    PrintStr("List:  ", fptr);
+
+    unsigned int count = sliding_median->ring.count;
+    unsigned short* widths = (unsigned short*)malloc(sizeof(unsigned short) * (count + 1));
+    double* temps = (double*)malloc(sizeof(double) * (count + 1));
+
+    if ((widths != NULL) && (temps != NULL))
+    {
+        for (unsigned int i = 0; i < count; i++)
+            widths[i] = sliding_median->ring.widths[GetSlotByAge(&sliding_median->ring, i)];
+
+        qsort(widths, count, sizeof(unsigned short), CompareWidths);
+
+        ConvertPulseWidthsToTemps(widths, temps, count);
+
+        for (unsigned int i = 0; i < count; i++)
+            PrintTemp(temps[i], fptr);
+    }
+
+    free(widths);
+    free(temps);
+
+    PrintStr("\n", fptr);
+#endif
+}
@@ -0,0 +1,36 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines sliding window median engine
+
+#pragma once
+
+#include "functions.h"
+#include "pulse_ring.h"
+
+// The sliding window median engine keeps the pulses of the current time window in two binary heaps:
+// a max-heap holding the lower half of the pulse widths and a min-heap holding the upper half.
+// The median is always found at the top of the heaps, so it is available without walking the window.
+// The pulses themselves are stored in a time-ordered ring buffer, which lets stale pulses be evicted 
+// from the oldest end. The companion index of every ring slot holds its position within its heap, 
+// so an evicted pulse is removed in O(log n).
+
+// Sliding window median engine
+typedef struct
+{
+    PulseRing ring;                 // Time-ordered window store
+    unsigned int* lower_heap;       // Max-heap of ring slots holding the lower half of the widths
+    unsigned int* upper_heap;       // Min-heap of ring slots holding the upper half of the widths
+    unsigned int lower_count;
+    unsigned int upper_count;
+    uint64_t window_length;         // Microseconds
+    unsigned long truncated_count;  // Pulses dropped from the window by a full ring before they became stale
+} SlidingMedian;
+
+// Function declarations
+bool InitSlidingMedian(SlidingMedian* sliding_median, unsigned int capacity, uint64_t window_length);
+void FreeSlidingMedian(SlidingMedian* sliding_median);
+unsigned int EvictStalePulses(SlidingMedian* sliding_median, uint64_t timestamp, FILE* fptr);
+void AddPulse(SlidingMedian* sliding_median, Pulse pulse, FILE* fptr);
+unsigned int GetMedian(const SlidingMedian* sliding_median);
+void PrintSlidingMedian(const SlidingMedian* sliding_median, FILE* fptr);
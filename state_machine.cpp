@@ -13,43 +13,127 @@ typedef struct
 {
     const char* name;
     void (*func)(FILE*);
+    bool warning_flag;          // The warnings are on in this state
 } STATE_FUNCTION_ROW_STRUCT;
 
 // Maps a state to its state transition function, which should be called when the state transitions into this state.
 // The order of the members must be in sync with the STATE_ENUM member declaration order.
 // This array has to stay in sync with the STATE_ENUM enumeration. That is, there must be the same number 
 // of rows in state_function as there are states in STATE_ENUM, and they must be in the same order.
+// A state with the warnings on must not be left with the warnings still on, so leaving it for a state 
+// with the warnings off turns them off first, unless the state function of the next state does so itself.
 
 static STATE_FUNCTION_ROW_STRUCT state_function[] = 
 {
-    // State name           // State function
-    { "STATE_WARNING_ON",   &Warning_On },
-    { "STATE_WARNING_OFF",  &Warning_Off }
+    // State name               // State function           // Warnings on
+    { "STATE_IDLE",             &Alarm_Idle,                false },
+    { "STATE_PRE_ALARM",        &Pre_Alarm,                 false },
+    { "STATE_WARNING_ON",       &Warning_On,                true },
+    { "STATE_WARNING_OFF",      &Warning_Off,               false },
+    { "STATE_LATCHED",          &Alarm_Latched,             false },
+    { "STATE_ACKNOWLEDGED",     &Alarm_Acknowledged,        false }
 };
 
+static_assert(sizeof(state_function) / sizeof(state_function[0]) == STATE_COUNT, 
+    "state_function must have a row for every state");
+
+// Printable event names, in sync with the EVENT_ENUM member declaration order
+static const char* event_name[] = 
+{
+    "EVENT_ALERT_RAISED",
+    "EVENT_ALERT_HELD",
+    "EVENT_ALERT_CLEARED",
+    "EVENT_ACKNOWLEDGE",
+    "EVENT_TICK"
+};
+
+static_assert(sizeof(event_name) / sizeof(event_name[0]) == EVENT_COUNT, 
+    "event_name must have a name for every event");
+
 // This following code defines a row in the state transition matrix (the state transition matrix is just an array of this structure). 
-// This structure contains the current state and the state to transition to.
+// This structure contains the current state, the event and the state to transition to.
 typedef struct 
 {
     STATE_ENUM curr_state;
+    EVENT_ENUM event;
     STATE_ENUM next_state;
 } STATE_TRANSITION_MATRIX_ROW_STRUCT;
 
 // The state transition matrix is the heart of this state machine methodology. 
-// Given the current state it specifies what the next state should be
-// It is built as an array of the curr_state/next_state structure defined above.
-static STATE_TRANSITION_MATRIX_ROW_STRUCT state_transition_matrix[] = 
+// Given the current state and an event it specifies what the next state should be.
+// It is built as an array of the curr_state/event/next_state structure defined above.
+// An event that has no row for the current state leaves the state machine where it is.
+// A latched alarm is left only once acknowledged or held again, so a brief alert cannot clear it.
+static constexpr STATE_TRANSITION_MATRIX_ROW_STRUCT state_transition_matrix[] = 
 {
-    // Current state     Next state
-    // Current state     Next state
-    { STATE_WARNING_ON,   STATE_WARNING_OFF },
-    { STATE_WARNING_OFF,  STATE_WARNING_ON }
+    // Current state        Event                   Next state
+    { STATE_IDLE,           EVENT_ALERT_RAISED,     STATE_PRE_ALARM },
+    { STATE_IDLE,           EVENT_ALERT_HELD,       STATE_WARNING_ON },
+    { STATE_PRE_ALARM,      EVENT_ALERT_HELD,       STATE_WARNING_ON },
+    { STATE_PRE_ALARM,      EVENT_ALERT_CLEARED,    STATE_IDLE },
+    { STATE_WARNING_ON,     EVENT_TICK,             STATE_WARNING_OFF },
+    { STATE_WARNING_ON,     EVENT_ALERT_CLEARED,    STATE_LATCHED },
+    { STATE_WARNING_ON,     EVENT_ACKNOWLEDGE,      STATE_ACKNOWLEDGED },
+    { STATE_WARNING_OFF,    EVENT_TICK,             STATE_WARNING_ON },
+    { STATE_WARNING_OFF,    EVENT_ALERT_CLEARED,    STATE_LATCHED },
+    { STATE_WARNING_OFF,    EVENT_ACKNOWLEDGE,      STATE_ACKNOWLEDGED },
+    { STATE_LATCHED,        EVENT_ALERT_HELD,       STATE_WARNING_ON },
+    { STATE_LATCHED,        EVENT_ACKNOWLEDGE,      STATE_IDLE },
+    { STATE_ACKNOWLEDGED,   EVENT_ALERT_CLEARED,    STATE_IDLE }
 };
 
+// The dense transition table holds one cell for every state and event pair, 
+// so that a transition is a single lookup however many rows the matrix has
+typedef struct 
+{
+    STATE_ENUM next_state;
+    bool transition_flag;       // The matrix has a row for this state and event
+} STATE_TRANSITION_CELL_STRUCT;
+
+typedef struct 
+{
+    STATE_TRANSITION_CELL_STRUCT cells[STATE_COUNT][EVENT_COUNT];
+} STATE_TRANSITION_TABLE_STRUCT;
+
+// Purpose: This function expands the state transition matrix into the dense transition table at compile time
+// Returns: The transition table
+static constexpr STATE_TRANSITION_TABLE_STRUCT BuildTransitionTable()
+{
+    STATE_TRANSITION_TABLE_STRUCT table = {};
+
+    for (int state = 0; state < STATE_COUNT; state++)
+    {
+        for (int event = 0; event < EVENT_COUNT; event++)
+        {
+            table.cells[state][event].next_state = (STATE_ENUM)state;
+            table.cells[state][event].transition_flag = false;
+        }
+    }
+
+    for (unsigned int i = 0; i < sizeof(state_transition_matrix) / sizeof(state_transition_matrix[0]); i++)
+    {
+        STATE_TRANSITION_CELL_STRUCT& cell = 
+            table.cells[state_transition_matrix[i].curr_state][state_transition_matrix[i].event];
+
+        cell.next_state = state_transition_matrix[i].next_state;
+        cell.transition_flag = true;
+    }
+
+    return table;
+}
+
+static constexpr STATE_TRANSITION_TABLE_STRUCT state_transition_table = BuildTransitionTable();
+
+static_assert(state_transition_table.cells[STATE_WARNING_ON][EVENT_TICK].next_state == STATE_WARNING_OFF, 
+    "The transition table must be built from the state transition matrix");
+
+static_assert(state_transition_table.cells[STATE_LATCHED][EVENT_ALERT_RAISED].transition_flag == false, 
+    "A latched alarm must not be left before it is acknowledged or held");
+
 // Purpose: This function initializes state machine
 void Init(STATE_MACHINE_STRUCT* state_machine) 
 {
-    state_machine->curr_state = STATE_WARNING_OFF;
+    state_machine->curr_state = STATE_IDLE;
 }
 
 // Purpose: This function retrieves state name
@@ -58,25 +142,36 @@ const char* GetStateName(STATE_ENUM state)
     return state_function[state].name;
 }
 
+// Purpose: This function retrieves event name
+const char* GetEventName(EVENT_ENUM event)
+{
+    return event_name[event];
+}
+
 // Purpose: This function governs transition between states.
-// All of the logic is controlled by the state transition matrix above. 
-// Essentially, the function runs through the state transition matrix 
-// row by row to find a pre-defined state that matches the current state. 
-// When found then it transitions to the specified next state and then calls 
-// the state function pointed to by the function pointer.
-void Transition(STATE_MACHINE_STRUCT *state_machine, FILE* fptr)
+// All of the logic is controlled by the state transition matrix above, 
+// which has been expanded into the transition table at compile time. 
+// The function looks up the cell of the current state and the event. 
+// When the matrix has a row for them it turns the warnings off if the next state has them off, 
+// transitions to the specified next state and then calls the state function pointed to by the function pointer.
+void Transition(STATE_MACHINE_STRUCT *state_machine, EVENT_ENUM event, FILE* fptr)
 {
-    // Iterate through the state transition matrix, checking if there is both a match with the current state and the event
-    for (int i = 0; i < sizeof(state_transition_matrix) / sizeof(state_transition_matrix[0]); i++) 
+    const STATE_TRANSITION_CELL_STRUCT* cell = &state_transition_table.cells[state_machine->curr_state][event];
+
+    if (cell->transition_flag == true)
     {
-        if (state_transition_matrix[i].curr_state == state_machine->curr_state) 
-        {
-            // Transition to the next state
-            state_machine->curr_state =  state_transition_matrix[i].next_state;
+        const STATE_FUNCTION_ROW_STRUCT* curr_row = &state_function[state_machine->curr_state];
+        const STATE_FUNCTION_ROW_STRUCT* next_row = &state_function[cell->next_state];
 
-            // Call the function associated with transition
+        // Turn the warnings off when leaving a state that has them on
+        if ((curr_row->warning_flag == true) && (next_row->warning_flag == false) && (next_row->func != &Warning_Off))
+            Warning_Off(fptr);
+
+        // Transition to the next state
+        state_machine->curr_state = cell->next_state;
+
+        // Call the function associated with transition
+        if (state_function[state_machine->curr_state].func != NULL)
             (state_function[state_machine->curr_state].func)(fptr);
-            break;
-        }
     }
-}
\ No newline at end of file
+}
@@ -5,15 +5,32 @@
 
 #pragma once
 
+// The order of the members must be in sync with the state_function array
 typedef enum {
-    STATE_WARNING_ON,
-    STATE_WARNING_OFF
+    STATE_IDLE,                 // No alert
+    STATE_PRE_ALARM,            // The median exceeds the warning threshold, but not yet for longer than allowed
+    STATE_WARNING_ON,           // Alarm, the warnings are on
+    STATE_WARNING_OFF,          // Alarm, the warnings are off until the next tick
+    STATE_LATCHED,              // The alarm has cleared, but has not been acknowledged; only a held alert or the acknowledgement leaves it
+    STATE_ACKNOWLEDGED,         // The alarm persists, but its warnings have been silenced
+    STATE_COUNT
 } STATE_ENUM;
 
+// Inputs that drive the state machine
+typedef enum {
+    EVENT_ALERT_RAISED,         // The median has exceeded the warning threshold
+    EVENT_ALERT_HELD,           // The median has exceeded the warning threshold for longer than allowed
+    EVENT_ALERT_CLEARED,        // The median has returned below the warning threshold
+    EVENT_ACKNOWLEDGE,          // The operator has acknowledged the alarm
+    EVENT_TICK,                 // The warning period has elapsed
+    EVENT_COUNT
+} EVENT_ENUM;
+
 // This simple state machine needs to remember only one thing, the current state. 
 // All the state machines variables are declared in the STATE_MACHINE_STRUCT.
 // A pointer to this struct gets passed in as the first variable to all the state machine functions, 
 // just like the 'this' object gets passed in the object-oriented world.
+// The struct is small and holds no pointers, so a single thread can drive the state machines of many channels.
 typedef struct 
 {
     STATE_ENUM curr_state;
@@ -21,4 +38,5 @@ typedef struct
 
 void Init(STATE_MACHINE_STRUCT* state_machine);
 const char* GetStateName(STATE_ENUM state);
-void Transition(STATE_MACHINE_STRUCT* state_machine, FILE* fptr);
+const char* GetEventName(EVENT_ENUM event);
+void Transition(STATE_MACHINE_STRUCT* state_machine, EVENT_ENUM event, FILE* fptr);
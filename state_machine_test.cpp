@@ -0,0 +1,107 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module tests the state machine transitions
+
+// Usage: StateMachineTest
+// Every test starts from the idle state, drives the state machine with a sequence of events
+// and checks the state after every event. The program prints one line per test and exits
+// with a nonzero status if any test fails.
+
+#include "functions.h"
+#include "state_machine.h"
+
+#define TEST_MAX_STEPS 8                // Largest number of events per test
+
+// Test step, an event and the state expected after it
+typedef struct
+{
+    EVENT_ENUM event;
+    STATE_ENUM expected_state;
+} TestStep;
+
+// Test case
+typedef struct
+{
+    const char* name;
+    unsigned int step_count;
+    TestStep steps[TEST_MAX_STEPS];
+} TestCase;
+
+static const TestCase test_cases[] =
+{
+    { "pre-alarm clears", 2, {
+        { EVENT_ALERT_RAISED,   STATE_PRE_ALARM },
+        { EVENT_ALERT_CLEARED,  STATE_IDLE } } },
+    { "warnings blink", 4, {
+        { EVENT_ALERT_RAISED,   STATE_PRE_ALARM },
+        { EVENT_ALERT_HELD,     STATE_WARNING_ON },
+        { EVENT_TICK,           STATE_WARNING_OFF },
+        { EVENT_TICK,           STATE_WARNING_ON } } },
+    { "cleared alarm latches", 4, {
+        { EVENT_ALERT_HELD,     STATE_WARNING_ON },
+        { EVENT_ALERT_CLEARED,  STATE_LATCHED },
+        { EVENT_TICK,           STATE_LATCHED },
+        { EVENT_ACKNOWLEDGE,    STATE_IDLE } } },
+    { "brief alert keeps latch", 5, {
+        { EVENT_ALERT_HELD,     STATE_WARNING_ON },
+        { EVENT_ALERT_CLEARED,  STATE_LATCHED },
+        { EVENT_ALERT_RAISED,   STATE_LATCHED },
+        { EVENT_ALERT_CLEARED,  STATE_LATCHED },
+        { EVENT_ACKNOWLEDGE,    STATE_IDLE } } },
+    { "held alert rearms latch", 4, {
+        { EVENT_ALERT_HELD,     STATE_WARNING_ON },
+        { EVENT_ALERT_CLEARED,  STATE_LATCHED },
+        { EVENT_ALERT_RAISED,   STATE_LATCHED },
+        { EVENT_ALERT_HELD,     STATE_WARNING_ON } } },
+    { "acknowledged alarm", 4, {
+        { EVENT_ALERT_HELD,     STATE_WARNING_ON },
+        { EVENT_ACKNOWLEDGE,    STATE_ACKNOWLEDGED },
+        { EVENT_TICK,           STATE_ACKNOWLEDGED },
+        { EVENT_ALERT_CLEARED,  STATE_IDLE } } }
+};
+
+// Purpose: This function runs a test case
+// Returns: True if the state after every event is the expected one; false otherwise
+static bool RunTestCase(const TestCase* test_case)
+{
+    STATE_MACHINE_STRUCT state_machine;
+
+    Init(&state_machine);
+
+    for (unsigned int i = 0; i < test_case->step_count; i++)
+    {
+        const TestStep* step = &test_case->steps[i];
+
+        Transition(&state_machine, step->event, NULL);
+
+        if (state_machine.curr_state != step->expected_state)
+        {
+            printf("FAIL %s: %s at step %u leads to %s, expected %s\n", test_case->name, GetEventName(step->event),
+                i, GetStateName(state_machine.curr_state), GetStateName(step->expected_state));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+    // The state functions must not log the transitions
+    SetLogLevel(LOG_LEVEL_NONE);
+
+    unsigned int failed_count = 0;
+
+    for (const TestCase& test_case : test_cases)
+    {
+        if (RunTestCase(&test_case))
+            printf("PASS %s\n", test_case.name);
+        else
+            failed_count++;
+    }
+
+    printf("%u of %u tests failed\n", failed_count, (unsigned int)(sizeof(test_cases) / sizeof(test_cases[0])));
+
+    return (failed_count > 0) ? 1 : 0;
+}
@@ -0,0 +1,235 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements processing instrumentation
+
+#include "stats.h"
+
+// Printable stage names, in sync with the STATS_STAGE member declaration order
+static const char* stage_name[] = 
+{
+    "ingest",
+    "evict",
+    "insert",
+    "median",
+    "alert",
+    "total"
+};
+
+static_assert(sizeof(stage_name) / sizeof(stage_name[0]) == STATS_STAGE_COUNT, 
+    "stage_name must have a name for every stage");
+
+// Statistics have a single writer, so a relaxed load and store updates a value without a locked instruction
+static inline void AddRelaxed(std::atomic<uint64_t>& value, uint64_t n)
+{
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Purpose: This function finds the index of the most significant set bit
+// Params: A non-zero value
+static inline unsigned int GetMostSignificantBit(uint64_t value)
+{
+    unsigned int bit = 0;
+
+    for (unsigned int shift = 32; shift > 0; shift >>= 1)
+    {
+        if ((value >> shift) != 0)
+        {
+            value >>= shift;
+            bit += shift;
+        }
+    }
+
+    return bit;
+}
+
+// Purpose: This function maps a latency to its histogram bucket
+// Latencies below 2^STATS_SUB_BUCKET_BITS nanoseconds have a bucket each; larger latencies are grouped by 
+// their magnitude, and every magnitude is split into STATS_HALF_SUB_BUCKET_COUNT linear sub-buckets
+static inline unsigned int GetBucketIndex(uint64_t latency)
+{
+    if (latency < 2 * STATS_HALF_SUB_BUCKET_COUNT)
+        return (unsigned int)latency;
+
+    if (latency >= (1ull << STATS_MAX_MAGNITUDE))
+        latency = (1ull << STATS_MAX_MAGNITUDE) - 1;
+
+    unsigned int shift = GetMostSignificantBit(latency) - (STATS_SUB_BUCKET_BITS - 1);
+
+    return (shift * STATS_HALF_SUB_BUCKET_COUNT) + (unsigned int)(latency >> shift);
+}
+
+// Purpose: This function retrieves the largest latency of a histogram bucket
+static inline uint64_t GetBucketUpperBound(unsigned int index)
+{
+    if (index < 2 * STATS_HALF_SUB_BUCKET_COUNT)
+        return index;
+
+    unsigned int shift = (index / STATS_HALF_SUB_BUCKET_COUNT) - 1;
+    uint64_t sub_bucket = index - (shift * STATS_HALF_SUB_BUCKET_COUNT);
+
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+// Purpose: This function initializes channel statistics
+void InitChannelStats(ChannelStats* stats)
+{
+    for (unsigned int stage = 0; stage < STATS_STAGE_COUNT; stage++)
+    {
+        LatencyHistogram* histogram = &stats->stages[stage];
+
+        for (unsigned int i = 0; i < STATS_BUCKET_COUNT; i++)
+            histogram->buckets[i].store(0);
+
+        histogram->count.store(0);
+        histogram->total.store(0);
+        histogram->max.store(0);
+    }
+
+    for (unsigned int counter = 0; counter < STATS_COUNTER_COUNT; counter++)
+        stats->counters[counter].store(0);
+
+    stats->window_size.store(0);
+    stats->window_size_max.store(0);
+}
+
+// Purpose: This function records the latency of a processing stage
+// Params: A pointer to the statistics, the stage and its latency in nanoseconds
+void RecordStageLatency(ChannelStats* stats, STATS_STAGE stage, uint64_t latency)
+{
+    LatencyHistogram* histogram = &stats->stages[stage];
+
+    AddRelaxed(histogram->buckets[GetBucketIndex(latency)], 1);
+    AddRelaxed(histogram->count, 1);
+    AddRelaxed(histogram->total, latency);
+
+    if (latency > histogram->max.load(std::memory_order_relaxed))
+        histogram->max.store(latency, std::memory_order_relaxed);
+}
+
+// Purpose: This function counts events
+void CountStatsEvent(ChannelStats* stats, STATS_COUNTER counter, uint64_t n)
+{
+    AddRelaxed(stats->counters[counter], n);
+}
+
+// Purpose: This function records the number of pulses in the window
+void SetStatsWindowSize(ChannelStats* stats, unsigned int size)
+{
+    stats->window_size.store(size, std::memory_order_relaxed);
+
+    if (size > stats->window_size_max.load(std::memory_order_relaxed))
+        stats->window_size_max.store(size, std::memory_order_relaxed);
+}
+
+// Purpose: This function retrieves the value of a counter
+uint64_t GetStatsCounter(const ChannelStats* stats, STATS_COUNTER counter)
+{
+    return stats->counters[counter].load(std::memory_order_relaxed);
+}
+
+// Purpose: This function retrieves the number of recorded latencies of a processing stage
+uint64_t GetStageLatencyCount(const ChannelStats* stats, STATS_STAGE stage)
+{
+    return stats->stages[stage].count.load(std::memory_order_relaxed);
+}
+
+// Purpose: This function retrieves the average latency of a processing stage
+// Returns: Nanoseconds or 0 if no latency has been recorded
+uint64_t GetStageLatencyAverage(const ChannelStats* stats, STATS_STAGE stage)
+{
+    uint64_t count = stats->stages[stage].count.load(std::memory_order_relaxed);
+
+    return (count > 0) ? (stats->stages[stage].total.load(std::memory_order_relaxed) / count) : 0;
+}
+
+// Purpose: This function retrieves the largest latency of a processing stage
+// Returns: Nanoseconds
+uint64_t GetStageLatencyMax(const ChannelStats* stats, STATS_STAGE stage)
+{
+    return stats->stages[stage].max.load(std::memory_order_relaxed);
+}
+
+// Purpose: This function retrieves a latency percentile of a processing stage
+// Params: A pointer to the statistics, the stage and the percentile in the range of [0, 100]
+// Returns: The upper bound of the bucket holding the percentile (nanoseconds) or 0 if no latency has been recorded
+uint64_t GetStageLatencyPercentile(const ChannelStats* stats, STATS_STAGE stage, double percentile)
+{
+    const LatencyHistogram* histogram = &stats->stages[stage];
+    uint64_t count = 0;
+
+    // The buckets are read one by one while they may still be updated, so they are summed up first
+    for (unsigned int i = 0; i < STATS_BUCKET_COUNT; i++)
+        count += histogram->buckets[i].load(std::memory_order_relaxed);
+
+    if (count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)count + 0.5);
+
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t cumulative_count = 0;
+
+    for (unsigned int i = 0; i < STATS_BUCKET_COUNT; i++)
+    {
+        cumulative_count += histogram->buckets[i].load(std::memory_order_relaxed);
+
+        if (cumulative_count >= rank)
+        {
+            uint64_t max = histogram->max.load(std::memory_order_relaxed);
+            uint64_t upper_bound = GetBucketUpperBound(i);
+
+            return ((max > 0) && (max < upper_bound)) ? max : upper_bound;
+        }
+    }
+
+    return histogram->max.load(std::memory_order_relaxed);
+}
+
+// Purpose: This function retrieves stage name
+const char* GetStageName(STATS_STAGE stage)
+{
+    return stage_name[stage];
+}
+
+// Purpose: This function prints the counters and the stage latency percentiles of a channel
+// Params: A pointer to the statistics, channel identifier, number of pulses dropped by the channel queue 
+// and the log file pointer
+void PrintChannelStats(const ChannelStats* stats, unsigned int id, unsigned long dropped_count, FILE* fptr)
+{
+    PrintStr("Channel", fptr);
+    PrintInt((int)id, fptr);
+    PrintStr(" processed:", fptr);
+    PrintUInt64(GetStatsCounter(stats, STATS_COUNTER_PROCESSED), fptr);
+    PrintStr(" dropped:", fptr);
+    PrintUInt64(dropped_count, fptr);
+    PrintStr(" evicted:", fptr);
+    PrintUInt64(GetStatsCounter(stats, STATS_COUNTER_EVICTED), fptr);
+    PrintStr(" window size:", fptr);
+    PrintInt((int)stats->window_size.load(std::memory_order_relaxed), fptr);
+    PrintStr(" maximum:", fptr);
+    PrintInt((int)stats->window_size_max.load(std::memory_order_relaxed), fptr);
+    PrintStr("\n", fptr);
+
+    for (unsigned int i = 0; i < STATS_STAGE_COUNT; i++)
+    {
+        STATS_STAGE stage = (STATS_STAGE)i;
+
+        if (GetStageLatencyCount(stats, stage) == 0)
+            continue;
+
+        PrintStr("\t", fptr);
+        PrintStr(GetStageName(stage), fptr);
+        PrintStr(" p50:", fptr);
+        PrintUInt64(GetStageLatencyPercentile(stats, stage, 50.0), fptr);
+        PrintStr(" p99:", fptr);
+        PrintUInt64(GetStageLatencyPercentile(stats, stage, 99.0), fptr);
+        PrintStr(" p99.9:", fptr);
+        PrintUInt64(GetStageLatencyPercentile(stats, stage, 99.9), fptr);
+        PrintStr(" maximum:", fptr);
+        PrintUInt64(GetStageLatencyMax(stats, stage), fptr);
+        PrintStr(" (nanoseconds)\n", fptr);
+    }
+}
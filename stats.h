@@ -0,0 +1,88 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines processing instrumentation
+
+#pragma once
+
+#include <atomic>
+
+#include "functions.h"
+
+// The instrumentation times every processing stage of every pulse and counts the pulses of every channel. 
+// Stage latencies are recorded into HDR-style histograms: values are grouped by their power of two magnitude 
+// and every magnitude is split into linear sub-buckets, so the relative error of a reported percentile is 
+// bounded by the sub-bucket resolution (about 6%) over the whole range while the histogram stays small.
+// Statistics are written by the worker processing the channel and may be read by any thread at any time. 
+// Comment out STATS_MODE to compile the recording out of the hot path altogether.
+
+#define STATS_MODE
+
+#define STATS_SUB_BUCKET_BITS 5                                 // Sub-bucket resolution of 2^-(bits - 1)
+#define STATS_HALF_SUB_BUCKET_COUNT (1 << (STATS_SUB_BUCKET_BITS - 1))
+#define STATS_MAX_MAGNITUDE 40                                  // Latencies are clamped below 2^40 ns (about 18 minutes)
+#define STATS_BUCKET_COUNT ((STATS_MAX_MAGNITUDE - STATS_SUB_BUCKET_BITS + 2) * STATS_HALF_SUB_BUCKET_COUNT)
+
+// Timed processing stages of a pulse
+typedef enum
+{
+    STATS_STAGE_INGEST,         // Pulse timestamp to the start of its processing
+    STATS_STAGE_EVICT,          // Eviction of the stale pulses
+    STATS_STAGE_INSERT,         // Insertion of the pulse into the window
+    STATS_STAGE_MEDIAN,         // Median calculation
+    STATS_STAGE_ALERT,          // Alert decision and publication
+    STATS_STAGE_TOTAL,          // Pulse timestamp to the alert publication
+    STATS_STAGE_COUNT
+} STATS_STAGE;
+
+// Counted events
+typedef enum
+{
+    STATS_COUNTER_PROCESSED,    // Processed pulses
+    STATS_COUNTER_EVICTED,      // Pulses evicted from the window
+    STATS_COUNTER_COUNT
+} STATS_COUNTER;
+
+// HDR-style latency histogram
+typedef struct
+{
+    std::atomic<uint64_t> buckets[STATS_BUCKET_COUNT];
+    std::atomic<uint64_t> count;                // Number of recorded latencies
+    std::atomic<uint64_t> total;                // Sum of the recorded latencies (nanoseconds)
+    std::atomic<uint64_t> max;                  // Largest recorded latency (nanoseconds)
+} LatencyHistogram;
+
+// Statistics of a channel
+typedef struct
+{
+    LatencyHistogram stages[STATS_STAGE_COUNT];
+    std::atomic<uint64_t> counters[STATS_COUNTER_COUNT];
+    std::atomic<unsigned int> window_size;      // Number of pulses in the window
+    std::atomic<unsigned int> window_size_max;  // Largest number of pulses in the window
+} ChannelStats;
+
+// Recording macros, which compile to nothing unless STATS_MODE is defined; only the count of STATS_COUNT is still evaluated
+#ifdef STATS_MODE
+#define STATS_TIMESTAMP(name) uint64_t name = GetMonotonicTimeNs()
+#define STATS_RECORD_STAGE(stats, stage, start, end) RecordStageLatency((stats), (stage), (end) - (start))
+#define STATS_COUNT(stats, counter, n) CountStatsEvent((stats), (counter), (n))
+#define STATS_WINDOW_SIZE(stats, size) SetStatsWindowSize((stats), (size))
+#else
+#define STATS_TIMESTAMP(name)
+#define STATS_RECORD_STAGE(stats, stage, start, end)
+#define STATS_COUNT(stats, counter, n) ((void)(n))
+#define STATS_WINDOW_SIZE(stats, size)
+#endif
+
+// Function declarations
+void InitChannelStats(ChannelStats* stats);
+void RecordStageLatency(ChannelStats* stats, STATS_STAGE stage, uint64_t latency);
+void CountStatsEvent(ChannelStats* stats, STATS_COUNTER counter, uint64_t n);
+void SetStatsWindowSize(ChannelStats* stats, unsigned int size);
+uint64_t GetStatsCounter(const ChannelStats* stats, STATS_COUNTER counter);
+uint64_t GetStageLatencyCount(const ChannelStats* stats, STATS_STAGE stage);
+uint64_t GetStageLatencyAverage(const ChannelStats* stats, STATS_STAGE stage);
+uint64_t GetStageLatencyMax(const ChannelStats* stats, STATS_STAGE stage);
+uint64_t GetStageLatencyPercentile(const ChannelStats* stats, STATS_STAGE stage, double percentile);
+const char* GetStageName(STATS_STAGE stage);
+void PrintChannelStats(const ChannelStats* stats, unsigned int id, unsigned long dropped_count, FILE* fptr);
@@ -0,0 +1,95 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module implements work-stealing deque
+
+#include "work_deque.h"
+
+// Purpose: This function initializes work deque
+// Params: A pointer to the deque and maximum number of work items
+// Returns: True if the deque storage and mutex have been allocated; false otherwise
+bool InitWorkDeque(WorkDeque* deque, unsigned int capacity)
+{
+    deque->items = (capacity > 0) ? (unsigned int*)malloc(sizeof(unsigned int) * capacity) : NULL;
+    deque->capacity = (deque->items != NULL) ? capacity : 0;
+    deque->top = 0;
+    deque->count = 0;
+
+    deque->mutex = NewMutex();
+
+    return ((deque->items != NULL) && (deque->mutex != NULL));
+}
+
+// Purpose: This function releases work deque storage
+void FreeWorkDeque(WorkDeque* deque)
+{
+    free(deque->items);
+
+    deque->items = NULL;
+    deque->capacity = 0;
+    deque->count = 0;
+
+    FreeMutex(deque->mutex);
+    deque->mutex = NULL;
+}
+
+// Purpose: This function pushes a work item at the bottom end of the deque
+// Returns: True if the item has been pushed; false if the deque is full
+bool PushWork(WorkDeque* deque, unsigned int item)
+{
+    bool pushed = false;
+
+    LockMutex(deque->mutex);
+
+    if (deque->count < deque->capacity)
+    {
+        deque->items[(deque->top + deque->count) % deque->capacity] = item;
+        deque->count++;
+        pushed = true;
+    }
+
+    UnlockMutex(deque->mutex);
+
+    return pushed;
+}
+
+// Purpose: This function pops the newest work item from the bottom end of the deque (owner side)
+// Returns: True if an item has been popped; false if the deque is empty
+bool PopWork(WorkDeque* deque, unsigned int* item)
+{
+    bool popped = false;
+
+    LockMutex(deque->mutex);
+
+    if (deque->count > 0)
+    {
+        deque->count--;
+        *item = deque->items[(deque->top + deque->count) % deque->capacity];
+        popped = true;
+    }
+
+    UnlockMutex(deque->mutex);
+
+    return popped;
+}
+
+// Purpose: This function steals the oldest work item from the top end of the deque (thief side)
+// Returns: True if an item has been stolen; false if the deque is empty
+bool StealWork(WorkDeque* deque, unsigned int* item)
+{
+    bool stolen = false;
+
+    LockMutex(deque->mutex);
+
+    if (deque->count > 0)
+    {
+        *item = deque->items[deque->top];
+        deque->top = (deque->top + 1) % deque->capacity;
+        deque->count--;
+        stolen = true;
+    }
+
+    UnlockMutex(deque->mutex);
+
+    return stolen;
+}
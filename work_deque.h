@@ -0,0 +1,32 @@
+// AUTHOR:		Mikhail Jacques
+// PROJECT:		Electrical Thermostat
+// DOCUMENT:	Electrical Thermostat
+// DESCRIPTION: This module defines work-stealing deque
+
+#pragma once
+
+#include "functions.h"
+#include "platform.h"
+
+// The work deque holds the work items (channel identifiers) scheduled to one worker.
+// Work items are pushed and popped by the owner at the bottom end, so the most recently 
+// scheduled channel, whose data are still warm in the cache, is processed first. 
+// Idle workers steal the oldest work items from the top end.
+// Pulses are submitted by threads other than the owner, hence both ends are guarded by a mutex.
+
+// Work-stealing deque
+typedef struct
+{
+    unsigned int* items;
+    unsigned int capacity;
+    unsigned int top;           // Index of the oldest item
+    unsigned int count;
+    struct Mutex* mutex;
+} WorkDeque;
+
+// Function declarations
+bool InitWorkDeque(WorkDeque* deque, unsigned int capacity);
+void FreeWorkDeque(WorkDeque* deque);
+bool PushWork(WorkDeque* deque, unsigned int item);
+bool PopWork(WorkDeque* deque, unsigned int* item);
+bool StealWork(WorkDeque* deque, unsigned int* item);